@@ -0,0 +1,733 @@
+/*
+    解析、输出、压缩、复制、查找的基准测试
+        cjson_bench [-t 秒] [-o results.json] [file.json ...]
+    不带文件时使用本地生成的三份语料，结构上仿照 nativejson-benchmark 的同名文件：
+        twitter  字符串多，含非 ASCII 字符和转义
+        canada   大量浮点数坐标
+        citm     数字键名、整数数组、层层嵌套的对象
+    另外用 keys_10 … keys_10000（一个对象里有 N 个随机键名）只比较 lookup 和 lookup_frozen
+    每一项结果是一个 JSON 对象（corpus/op/bytes/iterations/ns_per_op/mb_per_s/allocs_per_op/alloc_bytes_per_op/peak_rss_kb），
+    全部写到 -o 指定的文件（默认 stdout）；便于阅读的表格写到 stderr
+*/
+
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200112L // clock_gettime, getrusage
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include "cjson.h"
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+/* -------------------------------------------------------------------------- */
+/*                                 parameters                                 */
+/* -------------------------------------------------------------------------- */
+
+#define BENCH_MIN_ITERATIONS 3
+#define BENCH_DEFAULT_SECONDS 0.3
+
+typedef struct Doc {
+    const char *name;
+    char *text;      // 紧凑的原文
+    size_t length;
+    char *formatted; // cJson_Print 的结果，作为 minify 的输入
+    size_t formattedLength;
+    CJson *tree;
+    CJson *packed;   // 打开 packNumbers 解析的树
+    CJson *raw;      // 打开 rawStrings 解析的树，字符串引用 text
+    CJson **objects; // 查找测试用的 (对象, 键名) 对
+    const char **keys;
+    size_t pairs;
+    int frozen;      // lookup_frozen 已经冻结了 tree
+} Doc;
+
+// 一次迭代，返回计时部分的纳秒数；不计时的准备工作不能经过 cJson_malloc
+typedef double (*BenchFn)(Doc *doc);
+
+typedef struct BenchOp {
+    const char *name;
+    BenchFn fn;
+    int perPair; // 1 表示一次迭代包含 doc->pairs 次操作
+    int formattedInput;
+} BenchOp;
+
+static size_t allocCount, allocBytes;
+static CJson_Workspace *workspace; // parse_workspace/print_workspace 共用，跨迭代保留
+static double minSeconds = BENCH_DEFAULT_SECONDS;
+static uint64_t rngState = 0x2545F4914F6CDD1DULL;
+
+/* -------------------------------------------------------------------------- */
+/*                              static functions                              */
+/* -------------------------------------------------------------------------- */
+
+static void* count_malloc(size_t sz) {
+    ++allocCount;
+    allocBytes += sz;
+    return malloc(sz);
+}
+
+static double now_ns(void) {
+#ifdef _WIN32
+    return (double) clock() * (1e9 / CLOCKS_PER_SEC);
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+#endif
+}
+
+static long peak_rss_kb(void) {
+#ifdef _WIN32
+    return 0;
+#else
+    struct rusage ru;
+    if (getrusage(RUSAGE_SELF, &ru)) return 0;
+    return ru.ru_maxrss; // Linux 上单位是 KB
+#endif
+}
+
+static uint64_t rng(void) {
+    rngState ^= rngState << 13;
+    rngState ^= rngState >> 7;
+    rngState ^= rngState << 17;
+    return rngState;
+}
+
+static int rng_range(int n) {
+    return (int) (rng() % (uint64_t) n);
+}
+
+static double rng_double(double lo, double hi) {
+    return lo + (hi - lo) * (double) (rng() >> 11) / 9007199254740992.0;
+}
+
+// 随机文本：ASCII 单词夹杂日文、表情和需要转义的字符
+static void random_text(char *buf, int words) {
+    static const char *pool[] = {
+        "the", "json", "parser", "benchmark", "hello", "world", "@user", "#tag", "http://t.co/abc",
+        "\xe3\x81\x93\xe3\x82\x93\xe3\x81\xab\xe3\x81\xa1\xe3\x81\xaf", "\xe6\x97\xa5\xe6\x9c\xac",
+        "\xf0\x9f\x98\x80", "\"quoted\"", "line\nbreak", "tab\there", "RT"
+    };
+    int i;
+    buf[0] = 0;
+    for (i = 0; i < words; i++) {
+        if (i) strcat(buf, " ");
+        strcat(buf, pool[rng_range((int) (sizeof(pool) / sizeof(pool[0])))]);
+    }
+}
+
+// 像 twitter 的数据一样，数字 id 旁边再放一份字符串形式的 <name>_str
+static void add_id(CJson *object, const char *name, double id) {
+    char buf[32], key[32];
+    cJson_AddNumberToObject(object, name, id);
+    sprintf(buf, "%.0f", id);
+    sprintf(key, "%.20s_str", name);
+    cJson_AddStringToObject(object, key, buf);
+}
+
+static CJson* gen_twitter(void) {
+    CJson *root = cJson_CreateObject(), *statuses = cJson_CreateArray(), *s, *u, *e, *arr, *m;
+    char text[512];
+    int i, j;
+
+    cJson_AddItemToObject(root, "statuses", statuses);
+    for (i = 0; i < 600; i++) {
+        s = cJson_CreateObject();
+        cJson_AddStringToObject(s, "created_at", "Sun Aug 31 00:29:15 +0000 2014");
+        add_id(s, "id", 505874924095815681.0 + rng_range(1 << 30));
+        random_text(text, 4 + rng_range(16));
+        cJson_AddStringToObject(s, "text", text);
+        cJson_AddStringToObject(s, "source", "<a href=\"http://twitter.com/download/iphone\" rel=\"nofollow\">Twitter for iPhone</a>");
+        cJson_AddFalseToObject(s, "truncated");
+        cJson_AddNullToObject(s, "in_reply_to_status_id");
+        cJson_AddNullToObject(s, "in_reply_to_user_id");
+
+        u = cJson_CreateObject();
+        add_id(u, "id", 1186275104.0 + rng_range(1 << 20));
+        random_text(text, 2);
+        cJson_AddStringToObject(u, "name", text);
+        cJson_AddStringToObject(u, "screen_name", "ayuu0123");
+        cJson_AddStringToObject(u, "location", "");
+        random_text(text, 6 + rng_range(10));
+        cJson_AddStringToObject(u, "description", text);
+        cJson_AddNullToObject(u, "url");
+        e = cJson_CreateObject();
+        m = cJson_CreateObject();
+        cJson_AddItemToObject(m, "urls", cJson_CreateArray());
+        cJson_AddItemToObject(e, "description", m);
+        cJson_AddItemToObject(u, "entities", e);
+        cJson_AddFalseToObject(u, "protected");
+        cJson_AddNumberToObject(u, "followers_count", rng_range(5000));
+        cJson_AddNumberToObject(u, "friends_count", rng_range(5000));
+        cJson_AddNumberToObject(u, "listed_count", rng_range(50));
+        cJson_AddStringToObject(u, "created_at", "Thu Feb 28 04:27:20 +0000 2013");
+        cJson_AddNumberToObject(u, "favourites_count", rng_range(1000));
+        cJson_AddNumberToObject(u, "utc_offset", -36000);
+        cJson_AddStringToObject(u, "time_zone", "Hawaii");
+        cJson_AddBoolToObject(u, "geo_enabled", rng_range(2));
+        cJson_AddBoolToObject(u, "verified", 0);
+        cJson_AddNumberToObject(u, "statuses_count", rng_range(100000));
+        cJson_AddStringToObject(u, "lang", "ja");
+        cJson_AddStringToObject(u, "profile_background_color", "C0DEED");
+        cJson_AddStringToObject(u, "profile_image_url", "http://pbs.twimg.com/profile_images/497760886795153410/LDjAwR_y_normal.jpeg");
+        cJson_AddItemToObject(s, "user", u);
+
+        cJson_AddNullToObject(s, "geo");
+        cJson_AddNullToObject(s, "coordinates");
+        cJson_AddNumberToObject(s, "retweet_count", rng_range(100));
+        cJson_AddNumberToObject(s, "favorite_count", rng_range(100));
+        e = cJson_CreateObject();
+        cJson_AddItemToObject(e, "hashtags", cJson_CreateArray());
+        cJson_AddItemToObject(e, "symbols", cJson_CreateArray());
+        cJson_AddItemToObject(e, "urls", cJson_CreateArray());
+        arr = cJson_CreateArray();
+        for (j = rng_range(3); j > 0; j--) {
+            int indices[2];
+            m = cJson_CreateObject();
+            cJson_AddStringToObject(m, "screen_name", "aym0566x");
+            random_text(text, 1);
+            cJson_AddStringToObject(m, "name", text);
+            add_id(m, "id", 866260188.0 + rng_range(1 << 20));
+            indices[0] = rng_range(50);
+            indices[1] = indices[0] + 9;
+            cJson_AddItemToObject(m, "indices", cJson_CreateIntArray(indices, 2));
+            cJson_AddItemToArray(arr, m);
+        }
+        cJson_AddItemToObject(e, "user_mentions", arr);
+        cJson_AddItemToObject(s, "entities", e);
+        cJson_AddFalseToObject(s, "favorited");
+        cJson_AddFalseToObject(s, "retweeted");
+        cJson_AddStringToObject(s, "lang", "ja");
+        m = cJson_CreateObject();
+        cJson_AddStringToObject(m, "result_type", "recent");
+        cJson_AddStringToObject(m, "iso_language_code", "ja");
+        cJson_AddItemToObject(s, "metadata", m);
+        cJson_AddItemToArray(statuses, s);
+    }
+    m = cJson_CreateObject();
+    cJson_AddNumberToObject(m, "completed_in", 0.087);
+    add_id(m, "max_id", 505874924095815681.0);
+    cJson_AddStringToObject(m, "query", "%E4%B8%80");
+    cJson_AddNumberToObject(m, "count", 100);
+    cJson_AddItemToObject(root, "search_metadata", m);
+    return root;
+}
+
+static CJson* gen_canada(void) {
+    CJson *root = cJson_CreateObject(), *features = cJson_CreateArray(), *f, *p, *g, *rings, *ring;
+    double point[2], lon, lat;
+    int i, j;
+
+    cJson_AddStringToObject(root, "type", "FeatureCollection");
+    f = cJson_CreateObject();
+    cJson_AddStringToObject(f, "type", "Feature");
+    p = cJson_CreateObject();
+    cJson_AddStringToObject(p, "name", "Canada");
+    cJson_AddItemToObject(f, "properties", p);
+    g = cJson_CreateObject();
+    cJson_AddStringToObject(g, "type", "Polygon");
+    rings = cJson_CreateArray();
+    for (i = 0; i < 480; i++) {
+        ring = cJson_CreateArray();
+        lon = rng_double(-141.0, -52.6);
+        lat = rng_double(41.7, 83.1);
+        for (j = 50 + rng_range(200); j > 0; j--) {
+            lon += rng_double(-0.01, 0.01);
+            lat += rng_double(-0.01, 0.01);
+            point[0] = lon;
+            point[1] = lat;
+            cJson_AddItemToArray(ring, cJson_CreateDoubleArray(point, 2));
+        }
+        cJson_AddItemToArray(rings, ring);
+    }
+    cJson_AddItemToObject(g, "coordinates", rings);
+    cJson_AddItemToObject(f, "geometry", g);
+    cJson_AddItemToArray(features, f);
+    cJson_AddItemToObject(root, "features", features);
+    return root;
+}
+
+// 一个对象，n 个互不相同的随机键名
+static CJson* gen_keys(int n) {
+    CJson *root = cJson_CreateObject();
+    char key[32];
+    int i, j, len;
+    for (i = 0; i < n; i++) {
+        len = 4 + rng_range(8);
+        for (j = 0; j < len; j++) key[j] = (char) ('a' + rng_range(26));
+        sprintf(key + len, "_%d", i); // 后缀保证不重复
+        cJson_AddNumberToObject(root, key, i);
+    }
+    return root;
+}
+
+static CJson* gen_citm(void) {
+    CJson *root = cJson_CreateObject(), *names, *events, *perfs, *e, *p, *arr, *o, *a;
+    char key[32], text[512];
+    int i, j, ids[4];
+
+    names = cJson_CreateObject();
+    for (i = 0; i < 300; i++) {
+        sprintf(key, "%d", 205705993 + i * 6);
+        random_text(text, 2);
+        cJson_AddStringToObject(names, key, text);
+    }
+    cJson_AddItemToObject(root, "areaNames", names);
+    names = cJson_CreateObject();
+    for (i = 0; i < 40; i++) {
+        sprintf(key, "%d", 337100890 + i);
+        cJson_AddStringToObject(names, key, "Abonnement");
+    }
+    cJson_AddItemToObject(root, "audienceSubCategoryNames", names);
+
+    events = cJson_CreateObject();
+    for (i = 0; i < 180; i++) {
+        e = cJson_CreateObject();
+        cJson_AddNullToObject(e, "description");
+        cJson_AddNumberToObject(e, "id", 138586341 + i * 4);
+        cJson_AddNullToObject(e, "logo");
+        random_text(text, 3);
+        cJson_AddStringToObject(e, "name", text);
+        for (j = 0; j < 4; j++) ids[j] = 337184269 + rng_range(1000);
+        cJson_AddItemToObject(e, "subTopicIds", cJson_CreateIntArray(ids, 1 + rng_range(4)));
+        cJson_AddNullToObject(e, "subjectCode");
+        cJson_AddNullToObject(e, "subtitle");
+        cJson_AddItemToObject(e, "topicIds", cJson_CreateIntArray(ids, 1 + rng_range(4)));
+        sprintf(key, "%d", 138586341 + i * 4);
+        cJson_AddItemToObject(events, key, e);
+    }
+    cJson_AddItemToObject(root, "events", events);
+
+    perfs = cJson_CreateArray();
+    for (i = 0; i < 240; i++) {
+        p = cJson_CreateObject();
+        cJson_AddNumberToObject(p, "eventId", 138586341 + rng_range(180) * 4);
+        cJson_AddNumberToObject(p, "id", 339887544 + i);
+        cJson_AddNullToObject(p, "logo");
+        cJson_AddNullToObject(p, "name");
+        arr = cJson_CreateArray();
+        for (j = 1 + rng_range(8); j > 0; j--) {
+            o = cJson_CreateObject();
+            cJson_AddNumberToObject(o, "amount", 10000 + rng_range(100) * 250);
+            cJson_AddNumberToObject(o, "audienceSubCategoryId", 337100890 + rng_range(40));
+            cJson_AddNumberToObject(o, "seatCategoryId", 338937295 + rng_range(20));
+            cJson_AddItemToArray(arr, o);
+        }
+        cJson_AddItemToObject(p, "prices", arr);
+        arr = cJson_CreateArray();
+        for (j = 1 + rng_range(6); j > 0; j--) {
+            o = cJson_CreateObject();
+            a = cJson_CreateArray();
+            e = cJson_CreateObject();
+            cJson_AddNumberToObject(e, "areaId", 205705993 + rng_range(300) * 6);
+            cJson_AddItemToObject(e, "blockIds", cJson_CreateArray());
+            cJson_AddItemToArray(a, e);
+            cJson_AddItemToObject(o, "areas", a);
+            cJson_AddNumberToObject(o, "seatCategoryId", 338937295 + rng_range(20));
+            cJson_AddItemToArray(arr, o);
+        }
+        cJson_AddItemToObject(p, "seatCategories", arr);
+        cJson_AddNullToObject(p, "seatMapImage");
+        cJson_AddNumberToObject(p, "start", 1372701600000.0 + rng_range(1 << 30) * 1000.0);
+        cJson_AddStringToObject(p, "venueCode", "PLEYEL_PLEYEL");
+        cJson_AddItemToArray(perfs, p);
+    }
+    cJson_AddItemToObject(root, "performances", perfs);
+    names = cJson_CreateObject();
+    cJson_AddStringToObject(names, "PLEYEL_PLEYEL", "Salle Pleyel");
+    cJson_AddItemToObject(root, "venueNames", names);
+    return root;
+}
+
+// 收集所有 (对象, 键名) 对，查找测试按原顺序逐个查
+static int collect_pairs(Doc *doc) {
+    CJson **stack, *c;
+    size_t top = 0, size = 64, cap = 256;
+
+    stack = (CJson **) malloc(size * sizeof(CJson *));
+    doc->objects = (CJson **) malloc(cap * sizeof(CJson *));
+    doc->keys = (const char **) malloc(cap * sizeof(char *));
+    if (!stack || !doc->objects || !doc->keys) return 0;
+    doc->pairs = 0;
+    stack[top++] = doc->tree;
+    while (top) {
+        CJson *item = stack[--top];
+        for (c = item->child; c; c = c->next) {
+            if ((item->type & 255) == CJSON_Object) {
+                if (doc->pairs == cap) {
+                    cap *= 2;
+                    doc->objects = (CJson **) realloc(doc->objects, cap * sizeof(CJson *));
+                    doc->keys = (const char **) realloc(doc->keys, cap * sizeof(char *));
+                    if (!doc->objects || !doc->keys) return 0;
+                }
+                doc->objects[doc->pairs] = item;
+                doc->keys[doc->pairs++] = c->string;
+            }
+            if (c->child) {
+                if (top == size) {
+                    size *= 2;
+                    if (!(stack = (CJson **) realloc(stack, size * sizeof(CJson *)))) return 0;
+                }
+                stack[top++] = c;
+            }
+        }
+    }
+    free(stack);
+    return 1;
+}
+
+static int load_doc(Doc *doc, const char *name, char *text) {
+    CJson_ParseOptions opts;
+    memset(&opts, 0, sizeof(opts));
+    memset(doc, 0, sizeof(Doc));
+    doc->name = name;
+    doc->text = text;
+    doc->length = strlen(text);
+    if (!(doc->tree = cJson_Parse(text))) {
+        fprintf(stderr, "%s: parse error near byte %ld\n", name, (long) (cJson_GetErrorPtr() - text));
+        return 0;
+    }
+    opts.packNumbers = 1;
+    if (!(doc->packed = cJson_ParseEx(text, NULL, &opts))) return 0;
+    opts.packNumbers = 0;
+    opts.rawStrings = 1;
+    if (!(doc->raw = cJson_ParseEx(text, NULL, &opts))) return 0;
+    if (!(doc->formatted = cJson_Print(doc->tree))) return 0;
+    doc->formattedLength = strlen(doc->formatted);
+    return collect_pairs(doc);
+}
+
+static void free_doc(Doc *doc) {
+    cJson_Delete(doc->tree);
+    cJson_Delete(doc->packed);
+    cJson_Delete(doc->raw);
+    free(doc->text);
+    free(doc->formatted);
+    free(doc->objects);
+    free(doc->keys);
+}
+
+static char* read_file(const char *path) {
+    FILE *fp = fopen(path, "rb");
+    char *buf;
+    long len;
+
+    if (!fp) return NULL;
+    fseek(fp, 0, SEEK_END);
+    len = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    if (len < 0 || !(buf = (char *) malloc(len + 1))) {
+        fclose(fp);
+        return NULL;
+    }
+    len = (long) fread(buf, 1, len, fp);
+    buf[len] = 0;
+    fclose(fp);
+    return buf;
+}
+
+static double bench_parse(Doc *doc) {
+    double t = now_ns();
+    CJson *tree = cJson_Parse(doc->text);
+    t = now_ns() - t;
+    cJson_Delete(tree);
+    return t;
+}
+
+static double bench_parse_packed(Doc *doc) {
+    CJson_ParseOptions opts;
+    CJson *tree;
+    double t;
+    memset(&opts, 0, sizeof(opts));
+    opts.packNumbers = 1;
+    t = now_ns();
+    tree = cJson_ParseEx(doc->text, NULL, &opts);
+    t = now_ns() - t;
+    cJson_Delete(tree);
+    return t;
+}
+
+static double bench_parse_raw(Doc *doc) {
+    CJson_ParseOptions opts;
+    CJson *tree;
+    double t;
+    memset(&opts, 0, sizeof(opts));
+    opts.rawStrings = 1;
+    t = now_ns();
+    tree = cJson_ParseEx(doc->text, NULL, &opts);
+    t = now_ns() - t;
+    cJson_Delete(tree);
+    return t;
+}
+
+// 分步解析，每步最多 16 KB，衡量预算检查和多次进出的开销
+static double bench_parse_steps(Doc *doc) {
+    double t = now_ns();
+    CJson_Parser *parser = cJson_CreateParser(doc->text, NULL);
+    CJson *tree;
+    while (cJson_ParseStep(parser, 16384, 0) == CJSON_PARSE_PENDING);
+    tree = cJson_ParserResult(parser, NULL);
+    cJson_DeleteParser(parser);
+    t = now_ns() - t;
+    cJson_Delete(tree);
+    return t;
+}
+
+// 投影解析：只留下第二层各个值的 id 和 type，其余的都跳过
+static double bench_parse_projected(Doc *doc) {
+    const char *paths[2] = {"/*/*/id", "/*/*/type"};
+    double t = now_ns();
+    CJson *tree = cJson_ParseProjected(doc->text, paths, 2, NULL, NULL);
+    t = now_ns() - t;
+    cJson_Delete(tree);
+    return t;
+}
+
+static double bench_parse_workspace(Doc *doc) {
+    double t;
+    cJson_ResetWorkspace(workspace);
+    t = now_ns();
+    cJson_ParseWorkspace(workspace, doc->text, NULL, NULL);
+    return now_ns() - t;
+}
+
+static double bench_print(Doc *doc) {
+    double t = now_ns();
+    char *out = cJson_Print(doc->tree);
+    t = now_ns() - t;
+    free(out);
+    return t;
+}
+
+// 两个空格缩进、数组元素各占一行的排版
+static double bench_print_options(Doc *doc) {
+    CJson_PrintOptions opts;
+    double t;
+    char *out;
+    memset(&opts, 0, sizeof(opts));
+    opts.indentWidth = 2;
+    opts.afterColon = " ";
+    opts.arrayLines = 1;
+    t = now_ns();
+    out = cJson_PrintEx(doc->tree, &opts);
+    t = now_ns() - t;
+    free(out);
+    return t;
+}
+
+static double bench_print_unformatted(Doc *doc) {
+    double t = now_ns();
+    char *out = cJson_PrintUnformatted(doc->tree);
+    t = now_ns() - t;
+    free(out);
+    return t;
+}
+
+static double bench_print_packed(Doc *doc) {
+    double t = now_ns();
+    char *out = cJson_PrintUnformatted(doc->packed);
+    t = now_ns() - t;
+    free(out);
+    return t;
+}
+
+static double bench_print_raw(Doc *doc) {
+    double t = now_ns();
+    char *out = cJson_PrintUnformatted(doc->raw);
+    t = now_ns() - t;
+    free(out);
+    return t;
+}
+
+static double bench_print_buffered(Doc *doc) {
+    double t = now_ns();
+    char *out = cJson_PrintBuffered(doc->tree, (int) doc->length + 1, 0);
+    t = now_ns() - t;
+    free(out);
+    return t;
+}
+
+static double bench_print_workspace(Doc *doc) {
+    double t = now_ns();
+    cJson_PrintWorkspace(workspace, doc->tree, 0);
+    return now_ns() - t;
+}
+
+static double bench_minify(Doc *doc) {
+    static char *buf;
+    static size_t cap;
+    double t;
+
+    if (cap < doc->formattedLength + 1) {
+        free(buf);
+        cap = doc->formattedLength + 1;
+        if (!(buf = (char *) malloc(cap))) exit(1);
+    }
+    memcpy(buf, doc->formatted, doc->formattedLength + 1);
+    t = now_ns();
+    cJson_Minify(buf);
+    return now_ns() - t;
+}
+
+static double bench_duplicate(Doc *doc) {
+    double t = now_ns();
+    CJson *copy = cJson_Duplicate(doc->tree, 1);
+    t = now_ns() - t;
+    cJson_Delete(copy);
+    return t;
+}
+
+static double bench_lookup(Doc *doc) {
+    size_t i, found = 0;
+    double t = now_ns();
+    for (i = 0; i < doc->pairs; i++) found += cJson_GetObjectItem(doc->objects[i], doc->keys[i]) != NULL;
+    t = now_ns() - t;
+    if (found != doc->pairs) fprintf(stderr, "%s: lookup found %lu of %lu\n", doc->name, (unsigned long) found, (unsigned long) doc->pairs);
+    return t;
+}
+
+// 冻结放在预热的那次迭代里，不计时
+static double bench_lookup_frozen(Doc *doc) {
+    if (!doc->frozen) doc->frozen = cJson_FreezeObject(doc->tree, 1);
+    return bench_lookup(doc);
+}
+
+static const BenchOp ops[] = {
+    {"parse",             bench_parse,             0, 0},
+    {"parse_packed",      bench_parse_packed,      0, 0},
+    {"parse_raw",         bench_parse_raw,         0, 0},
+    {"parse_steps",       bench_parse_steps,       0, 0},
+    {"parse_projected",   bench_parse_projected,   0, 0},
+    {"parse_workspace",   bench_parse_workspace,   0, 0},
+    {"print",             bench_print,             0, 0},
+    {"print_options",     bench_print_options,     0, 0},
+    {"print_unformatted", bench_print_unformatted, 0, 0},
+    {"print_buffered",    bench_print_buffered,    0, 0},
+    {"print_packed",      bench_print_packed,      0, 0},
+    {"print_raw",         bench_print_raw,         0, 0},
+    {"print_workspace",   bench_print_workspace,   0, 0},
+    {"minify",            bench_minify,            0, 1},
+    {"duplicate",         bench_duplicate,         0, 0},
+    {"lookup",            bench_lookup,            1, 0},
+    {"lookup_frozen",     bench_lookup_frozen,     1, 0} // 会冻结 doc->tree，放在最后
+};
+
+// 按键名个数比较线性查找和二分查找
+static const BenchOp lookupOps[] = {
+    {"lookup",            bench_lookup,            1, 0},
+    {"lookup_frozen",     bench_lookup_frozen,     1, 0}
+};
+
+static void run_op(Doc *doc, const BenchOp *op, CJson *results) {
+    double elapsed = 0, start = now_ns(), ns, mbps;
+    size_t allocs = allocCount, allocated, bytes = op->formattedInput ? doc->formattedLength : doc->length, perIter = 1;
+    long iterations = 0, count;
+    CJson *r;
+
+    op->fn(doc); // 预热
+    allocs = allocCount;
+    allocated = allocBytes;
+    while (iterations < BENCH_MIN_ITERATIONS || now_ns() - start < minSeconds * 1e9) {
+        elapsed += op->fn(doc);
+        ++iterations;
+    }
+    allocs = allocCount - allocs;
+    allocated = allocBytes - allocated;
+    if (op->perPair) perIter = doc->pairs ? doc->pairs : 1;
+    count = iterations * (long) perIter;
+    ns = elapsed / count;
+    mbps = op->perPair ? 0 : bytes / (elapsed / iterations) * 1e9 / (1024.0 * 1024.0);
+
+    r = cJson_CreateObject();
+    cJson_AddStringToObject(r, "corpus", doc->name);
+    cJson_AddStringToObject(r, "op", op->name);
+    cJson_AddNumberToObject(r, "bytes", (double) bytes);
+    cJson_AddNumberToObject(r, "iterations", (double) count);
+    cJson_AddNumberToObject(r, "ns_per_op", ns);
+    if (op->perPair) cJson_AddNullToObject(r, "mb_per_s");
+    else cJson_AddNumberToObject(r, "mb_per_s", mbps);
+    cJson_AddNumberToObject(r, "allocs_per_op", (double) allocs / count);
+    cJson_AddNumberToObject(r, "alloc_bytes_per_op", (double) allocated / count);
+    cJson_AddNumberToObject(r, "peak_rss_kb", (double) peak_rss_kb());
+    cJson_AddItemToArray(results, r);
+
+    fprintf(stderr, "%-10s %-18s %10.1f MB/s %14.1f ns/op %12.2f allocs/op %14.1f B/op %8ld KB\n",
+            doc->name, op->name, mbps, ns, (double) allocs / count, (double) allocated / count, peak_rss_kb());
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "usage: %s [-t seconds] [-o results.json] [file.json ...]\n", prog);
+    exit(2);
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                     main                                   */
+/* -------------------------------------------------------------------------- */
+
+int main(int argc, char **argv) {
+    CJson_Hooks hooks = {count_malloc, free};
+    CJson *results, *(*gens[3])(void) = {gen_twitter, gen_canada, gen_citm}, *tree;
+    const char *names[3] = {"twitter", "canada", "citm"}, *outPath = NULL, *slash;
+    static const char *keyNames[4] = {"keys_10", "keys_100", "keys_1000", "keys_10000"};
+    char *text, *out;
+    Doc doc;
+    FILE *fp;
+    int i, n, files = 0;
+    size_t k;
+
+    cJson_InitHooks(&hooks);
+    for (i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-t") && i + 1 < argc) minSeconds = atof(argv[++i]);
+        else if (!strcmp(argv[i], "-o") && i + 1 < argc) outPath = argv[++i];
+        else if (argv[i][0] == '-') usage(argv[0]);
+        else argv[++files] = argv[i]; // 文件名移到前面
+    }
+
+    if (!(workspace = cJson_CreateWorkspace())) return 1;
+    results = cJson_CreateArray();
+    for (i = 0; i < (files ? files : 3); i++) {
+        if (files) {
+            if (!(text = read_file(argv[i + 1]))) {
+                fprintf(stderr, "cannot read %s\n", argv[i + 1]);
+                return 1;
+            }
+            slash = strrchr(argv[i + 1], '/');
+            if (!load_doc(&doc, slash ? slash + 1 : argv[i + 1], text)) return 1;
+        } else {
+            tree = gens[i]();
+            text = cJson_PrintUnformatted(tree);
+            cJson_Delete(tree);
+            if (!text || !load_doc(&doc, names[i], text)) return 1;
+        }
+        for (k = 0; k < sizeof(ops) / sizeof(ops[0]); k++) run_op(&doc, &ops[k], results);
+        free_doc(&doc);
+    }
+    for (i = 0, n = 10; !files && i < 4; i++, n *= 10) {
+        tree = gen_keys(n);
+        text = cJson_PrintUnformatted(tree);
+        cJson_Delete(tree);
+        if (!text || !load_doc(&doc, keyNames[i], text)) return 1;
+        for (k = 0; k < sizeof(lookupOps) / sizeof(lookupOps[0]); k++) run_op(&doc, &lookupOps[k], results);
+        free_doc(&doc);
+    }
+
+    cJson_DeleteWorkspace(workspace);
+    out = cJson_Print(results);
+    cJson_Delete(results);
+    if (!out) return 1;
+    fp = outPath ? fopen(outPath, "w") : stdout;
+    if (!fp) {
+        fprintf(stderr, "cannot write %s\n", outPath);
+        return 1;
+    }
+    fprintf(fp, "%s\n", out);
+    if (outPath) fclose(fp);
+    free(out);
+    return 0;
+}
@@ -0,0 +1,174 @@
+/*
+    没有 libFuzzer 时的入口，与任一 fuzz_*.c 链接：
+        fuzz_xxx file...               逐个回放输入（AFL: fuzz_xxx @@）
+        fuzz_xxx -runs=N [-seed=S] file...
+                                       以这些文件为种子做 N 次随机变异，崩溃或检查失败时
+                                       把当前输入写到 crash-input
+        fuzz_xxx                       从 stdin 读一个输入
+    最好和库一起用 -fsanitize=address,undefined 编译（CMake 选项 CJSON_SANITIZE）
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+
+#define DRIVER_MAX_INPUT (1 << 20)
+
+extern int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+typedef struct Input {
+    uint8_t *data;
+    size_t size;
+} Input;
+
+static uint64_t rngState = 88172645463325252ULL;
+static const uint8_t *current;
+static size_t currentSize;
+
+// 变异时插入的片段，覆盖 JSON 的各种记号和容易出错的边界
+static const char *tokens[] = {
+    "{", "}", "[", "]", ",", ":", "\"", "\\", "\\u", "\\ud800", "\\udc00", "\\u0000", "\\\"",
+    "true", "false", "null", "-", "0", "1e999", "-1e-999", "1.5", "9007199254740993", "2147483648",
+    "1e", ".", "/*", "*/", "//", "\n", " ", "\xf0\x9f\x98\x80", "\xc3", "\xed\xa0\x80", "\xff",
+    "{\"a\":", "[[[[[[[[", "]]]]]]]]", "\"key\":\"value\"", "0.1", "-0"
+};
+
+static uint64_t rng(void) {
+    rngState ^= rngState << 13;
+    rngState ^= rngState >> 7;
+    rngState ^= rngState << 17;
+    return rngState;
+}
+
+static void save_crash(int sig) {
+    FILE *fp = fopen("crash-input", "wb");
+    if (fp && current) {
+        fwrite(current, 1, currentSize, fp);
+    }
+    if (fp) fclose(fp);
+    signal(sig, SIG_DFL);
+    raise(sig);
+}
+
+static int read_input(FILE *fp, Input *in) {
+    size_t cap = 4096, n;
+    in->size = 0;
+    if (!(in->data = (uint8_t *) malloc(cap))) return 0;
+    while ((n = fread(in->data + in->size, 1, cap - in->size, fp)) > 0) {
+        in->size += n;
+        if (in->size == cap) {
+            cap *= 2;
+            if (!(in->data = (uint8_t *) realloc(in->data, cap))) return 0;
+        }
+    }
+    return 1;
+}
+
+static void run_one(const uint8_t *data, size_t size) {
+    current = data;
+    currentSize = size;
+    LLVMFuzzerTestOneInput(data, size);
+    current = NULL;
+}
+
+// 在 buf（容量 DRIVER_MAX_INPUT）上做 1~4 次变异，返回新长度
+static size_t mutate(uint8_t *buf, size_t size, const Input *seeds, int seedCount) {
+    int rounds = 1 + (int) (rng() % 4);
+    size_t pos, len, n;
+    const Input *other;
+    const char *tok;
+
+    while (rounds--) {
+        pos = size ? rng() % (size + 1) : 0;
+        switch (rng() % 6) {
+            case 0: // 翻转一个字节
+                if (size) buf[pos % size] ^= (uint8_t) (1u << (rng() % 8));
+                break;
+            case 1: // 插入记号
+                tok = tokens[rng() % (sizeof(tokens) / sizeof(tokens[0]))];
+                n = strlen(tok);
+                if (size + n > DRIVER_MAX_INPUT) break;
+                memmove(buf + pos + n, buf + pos, size - pos);
+                memcpy(buf + pos, tok, n);
+                size += n;
+                break;
+            case 2: // 删除一段
+                if (!size || pos >= size) break;
+                len = 1 + rng() % (size - pos);
+                if (len > 16) len = 1 + len % 16;
+                memmove(buf + pos, buf + pos + len, size - pos - len);
+                size -= len;
+                break;
+            case 3: // 复制一段到别处
+                if (!size) break;
+                len = 1 + rng() % (size < 64 ? size : 64);
+                n = rng() % (size - len + 1);
+                if (size + len > DRIVER_MAX_INPUT) break;
+                memmove(buf + pos + len, buf + pos, size - pos);
+                memmove(buf + pos, buf + n + (n >= pos ? len : 0), len);
+                size += len;
+                break;
+            case 4: // 截断
+                size = pos;
+                break;
+            default: // 拼接另一个种子的开头
+                other = &seeds[rng() % seedCount];
+                len = other->size ? rng() % (other->size + 1) : 0;
+                if (pos + len > DRIVER_MAX_INPUT) break;
+                memcpy(buf + pos, other->data, len);
+                size = pos + len;
+                break;
+        }
+    }
+    return size;
+}
+
+int main(int argc, char **argv) {
+    long runs = 0, i;
+    Input *seeds, in;
+    int seedCount = 0, k;
+    uint8_t *buf;
+    size_t size;
+    FILE *fp;
+
+    signal(SIGABRT, save_crash);
+    signal(SIGSEGV, save_crash);
+    if (!(seeds = (Input *) calloc(argc + 1, sizeof(Input)))) return 1;
+    for (k = 1; k < argc; k++) {
+        if (!strncmp(argv[k], "-runs=", 6)) runs = atol(argv[k] + 6);
+        else if (!strncmp(argv[k], "-seed=", 6)) rngState ^= (uint64_t) strtoull(argv[k] + 6, NULL, 10) * 0x9E3779B97F4A7C15ULL;
+        else if (argv[k][0] == '-') continue; // 忽略 libFuzzer 的其它选项
+        else {
+            if (!(fp = fopen(argv[k], "rb"))) {
+                fprintf(stderr, "cannot read %s\n", argv[k]);
+                return 1;
+            }
+            if (!read_input(fp, &seeds[seedCount])) return 1;
+            fclose(fp);
+            run_one(seeds[seedCount].data, seeds[seedCount].size);
+            seedCount++;
+        }
+    }
+    if (!seedCount) {
+        if (!read_input(stdin, &in)) return 1;
+        run_one(in.data, in.size);
+        if (!runs) return 0;
+        seeds[seedCount++] = in;
+    }
+
+    if (!(buf = (uint8_t *) malloc(DRIVER_MAX_INPUT))) return 1;
+    for (i = 0; i < runs; i++) {
+        const Input *seed = &seeds[rng() % seedCount];
+        size = seed->size < DRIVER_MAX_INPUT ? seed->size : DRIVER_MAX_INPUT;
+        memcpy(buf, seed->data, size);
+        size = mutate(buf, size, seeds, seedCount);
+        run_one(buf, size);
+    }
+    fprintf(stderr, "%d seeds, %ld runs done\n", seedCount, runs);
+    for (k = 0; k < seedCount; k++) free(seeds[k].data);
+    free(seeds);
+    free(buf);
+    return 0;
+}
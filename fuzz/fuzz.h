@@ -0,0 +1,43 @@
+/*
+    模糊测试目标共用的小工具。每个 fuzz_*.c 定义一个 LLVMFuzzerTestOneInput，
+    可以直接用 libFuzzer（clang -fsanitize=fuzzer）或 AFL++ 的 libFuzzer 模式编译，
+    也可以和 driver.c 链接成普通程序回放/变异输入。发现不一致时调用 abort()
+*/
+
+#ifndef CJSON_FUZZ_H
+#define CJSON_FUZZ_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cjson.h"
+
+#define FUZZ_CHECK(cond) do { if (!(cond)) { fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); abort(); } } while (0)
+
+// 输入复制成以 0 结尾的字符串；输入中间的 0 字节保留，解析到那里为止
+static inline char* fuzz_string(const uint8_t *data, size_t size) {
+    char *text = (char *) malloc(size + 1);
+    if (!text) abort();
+    memcpy(text, data, size);
+    text[size] = 0;
+    return text;
+}
+
+// 树中是否有 NaN/无穷大（如 1e999）：它们输出为 null，重新解析后不再相等
+static inline int fuzz_has_nonfinite(CJson *item) {
+    CJson *c;
+    if ((item->type & 255) == CJSON_Number) return item->dValue != item->dValue || item->dValue - item->dValue != 0;
+    for (c = item->child; c; c = c->next) {
+        if (fuzz_has_nonfinite(c)) return 1;
+    }
+    return 0;
+}
+
+// 两个以 0 结尾的输出相同，cJson_Print* 失败时都为 NULL
+static inline int fuzz_same(const char *a, const char *b) {
+    if (!a || !b) return a == b;
+    return !strcmp(a, b);
+}
+
+#endif
@@ -0,0 +1,339 @@
+// 差分：同一份输入在各种解析方式下得到相等的树，同一棵树在各种输出方式下得到相同的文本
+
+#include "fuzz.h"
+#include "cjson_cache.h"
+#include "cjson_stream.h"
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#endif
+
+static CJson_ParseCache *cache;
+static CJson_Workspace *workspace;
+
+static CJson* parse_with(const char *text, int strict, CJson_KeyTable *keys, int requireNullTerminated, int packNumbers, int rawStrings) {
+    CJson_ParseOptions opts;
+    memset(&opts, 0, sizeof(opts));
+    opts.strictStrings = strict;
+    opts.keys = keys;
+    opts.requireNullTerminated = requireNullTerminated;
+    opts.packNumbers = packNumbers;
+    opts.rawStrings = rawStrings;
+    return cJson_ParseEx(text, NULL, &opts);
+}
+
+// 分步解析，每步只处理 maxNodes 个值
+static CJson* parse_steps(const char *text, size_t maxNodes) {
+    CJson_Parser *parser = cJson_CreateParser(text, NULL);
+    CJson *cj;
+    while (cJson_ParseStep(parser, 0, maxNodes) == CJSON_PARSE_PENDING);
+    cj = cJson_ParserResult(parser, NULL);
+    cJson_DeleteParser(parser);
+    return cj;
+}
+
+// 从完整的树里挑出路径 "/a" 和 "/*/0"，作为投影解析的参照
+static CJson* project(CJson *base) {
+    CJson *out, *c, *g, *sub;
+    int object = (base->type & 255) == CJSON_Object;
+    if (!object && (base->type & 255) != CJSON_Array) return cJson_Duplicate(base, 1);
+    out = object ? cJson_CreateObject() : cJson_CreateArray();
+    for (c = base->child; c; c = c->next) {
+        if (object && !strcmp(c->string, "a")) {
+            sub = cJson_Duplicate(c, 1);
+        } else if ((c->type & 255) == CJSON_Object) {
+            sub = cJson_CreateObject();
+            for (g = c->child; g; g = g->next) {
+                if (!strcmp(g->string, "0")) cJson_AddItemToObject(sub, g->string, cJson_Duplicate(g, 1));
+            }
+        } else if ((c->type & 255) == CJSON_Array) {
+            sub = cJson_CreateArray();
+            if (c->child) cJson_AddItemToArray(sub, cJson_Duplicate(c->child, 1));
+        } else {
+            continue;
+        }
+        if (object) cJson_AddItemToObject(out, c->string, sub);
+        else cJson_AddItemToArray(out, sub);
+    }
+    return out;
+}
+
+// frozen 是 base 冻结后的副本：按 base 每个成员的键名查找，两边找到的成员位置相同
+static void check_frozen(CJson *base, CJson *frozen) {
+    CJson *a, *b, *c, *x, *y;
+    int i;
+    for (a = base->child, b = frozen->child; a; a = a->next, b = b->next) {
+        if ((base->type & 255) == CJSON_Object) {
+            for (i = 0; i < 2; i++) {
+                x = i ? cJson_GetObjectItemCaseSensitive(base, a->string) : cJson_GetObjectItem(base, a->string);
+                y = i ? cJson_GetObjectItemCaseSensitive(frozen, a->string) : cJson_GetObjectItem(frozen, a->string);
+                for (c = base->child; c != x; c = c->next) y = y ? y->prev : NULL;
+                FUZZ_CHECK(y == frozen->child);
+            }
+        }
+        check_frozen(a, b);
+    }
+}
+
+// other 只在 base 成功时才可能成功（strict 或 requireNullTerminated 更严格）；都成功时必须相等
+static void check_parse(CJson *base, CJson *other, int mustMatch) {
+    if (other) FUZZ_CHECK(base && cJson_Equals(base, other));
+    if (mustMatch) FUZZ_CHECK(!base == !other);
+    cJson_Delete(other);
+}
+
+// 分段输出拼接起来的文本
+static char* print_segments(CJson *json, int fmt) {
+    CJson_Segments segs;
+    size_t total = 0;
+    char *out;
+    int i;
+
+    memset(&segs, 0, sizeof(segs));
+    if (!cJson_PrintSegments(json, fmt, &segs)) {
+        cJson_FreeSegments(&segs);
+        return NULL;
+    }
+    for (i = 0; i < segs.count; i++) total += segs.segs[i].len;
+    if (!(out = (char *) malloc(total + 1))) abort();
+    for (total = 0, i = 0; i < segs.count; i++) {
+        memcpy(out + total, segs.segs[i].base, segs.segs[i].len);
+        total += segs.segs[i].len;
+    }
+    out[total] = 0;
+    cJson_FreeSegments(&segs);
+    return out;
+}
+
+static void check_print(CJson *json) {
+    char *formatted = cJson_Print(json), *compact = cJson_PrintUnformatted(json), *other, *minified;
+    CJson_PrintOptions opts;
+
+    FUZZ_CHECK(formatted && compact);
+    other = cJson_PrintBuffered(json, 1, 1); // 从 1 字节开始扩容
+    FUZZ_CHECK(fuzz_same(formatted, other));
+    free(other);
+    other = cJson_PrintBuffered(json, 1, 0);
+    FUZZ_CHECK(fuzz_same(compact, other));
+    free(other);
+    other = print_segments(json, 1);
+    FUZZ_CHECK(fuzz_same(formatted, other));
+    free(other);
+    other = print_segments(json, 0);
+    FUZZ_CHECK(fuzz_same(compact, other));
+    free(other);
+
+    minified = (char *) malloc(strlen(formatted) + 1);
+    if (!minified) abort();
+    strcpy(minified, formatted);
+    cJson_Minify(minified);
+    FUZZ_CHECK(fuzz_same(compact, minified));
+    free(minified);
+
+    // 自定义排版只改变空白
+    other = cJson_PrintEx(json, NULL);
+    FUZZ_CHECK(fuzz_same(formatted, other));
+    free(other);
+    memset(&opts, 0, sizeof(opts));
+    opts.indentWidth = 2;
+    opts.newline = "\r\n";
+    opts.afterColon = " ";
+    opts.arrayLines = 1;
+    other = cJson_PrintEx(json, &opts);
+    FUZZ_CHECK(other != NULL);
+    cJson_Minify(other);
+    FUZZ_CHECK(fuzz_same(compact, other));
+    free(other);
+    free(formatted);
+    free(compact);
+}
+
+// 格式化和紧凑的输出接在一起写进临时文件，用很小的窗口按流读回来，得到两个与 json 相等的值
+static void check_stream(CJson *json) {
+#if defined(__unix__) || defined(__APPLE__)
+    char *formatted = cJson_Print(json), *compact = cJson_PrintUnformatted(json);
+    FILE *fp = tmpfile();
+    CJson_Stream *stream;
+    CJson *value;
+    int i;
+
+    if (!fp || !formatted || !compact) abort();
+    fprintf(fp, "%s %s", formatted, compact);
+    fflush(fp);
+    lseek(fileno(fp), 0, SEEK_SET);
+    stream = cJson_OpenStream(fileno(fp), 1 + strlen(compact) % 64, NULL);
+    FUZZ_CHECK(stream != NULL);
+    for (i = 0; i < 2; i++) {
+        FUZZ_CHECK(cJson_StreamNext(stream, &value) == CJSON_STREAM_VALUE);
+        FUZZ_CHECK(cJson_Equals(json, value));
+        cJson_Delete(value);
+    }
+    FUZZ_CHECK(cJson_StreamNext(stream, &value) == CJSON_STREAM_END);
+    cJson_CloseStream(stream);
+    fclose(fp);
+    free(formatted);
+    free(compact);
+#else
+    (void) json;
+#endif
+}
+
+// 两棵相等的树的各种输出都相同
+static void check_same_print(CJson *a, CJson *b) {
+    char *x, *y;
+    x = cJson_Print(a);
+    y = cJson_Print(b);
+    FUZZ_CHECK(fuzz_same(x, y));
+    free(x);
+    free(y);
+    x = cJson_PrintCanonical(a);
+    y = cJson_PrintCanonical(b);
+    FUZZ_CHECK(fuzz_same(x, y));
+    free(x);
+    free(y);
+    check_print(b);
+}
+
+// 按下标读数字：紧凑的树与普通的树读到相同的值，紧凑数组读完后仍然是紧凑的
+static void check_packed_numbers(CJson *base, CJson *packed) {
+    CJson *a, *b = packed->child;
+    double x, y;
+    int i = 0, packedBefore = packed->type & cJson_IsPacked;
+    if ((base->type & 255) == CJSON_Array) {
+        for (a = base->child; a; a = a->next, i++) {
+            FUZZ_CHECK(cJson_GetPackedNumber(base, i, &x) == cJson_GetPackedNumber(packed, i, &y));
+            if ((a->type & 255) == CJSON_Number) FUZZ_CHECK(x == y || (x != x && y != y));
+        }
+        FUZZ_CHECK(!cJson_GetPackedNumber(packed, i, NULL));
+        FUZZ_CHECK((packed->type & cJson_IsPacked) == packedBefore);
+    }
+    if (packedBefore) return;
+    for (a = base->child; a; a = a->next, b = b->next) check_packed_numbers(a, b);
+}
+
+// 给字符串、true/false/null 节点写数值：类型不变，内联的字符串和键名不能被数值覆盖
+static void check_set_number(CJson *base, CJson *tree) {
+    CJson *stack[64], *c;
+    int depth = 0, type;
+    stack[depth++] = tree;
+    while (depth) {
+        for (c = stack[--depth]->child; c; c = c->next) {
+            type = c->type & 255;
+            if (type == CJSON_Array || type == CJSON_Object) {
+                if (depth < 64) stack[depth++] = c;
+            } else if (type != CJSON_Number) {
+                FUZZ_CHECK(cJson_SetIntValue(c, 7) == 7);
+                FUZZ_CHECK(c->iValue == 7 && c->dValue == 7);
+            }
+        }
+    }
+    FUZZ_CHECK(cJson_Equals(base, tree));
+    check_same_print(base, tree);
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    char *text = fuzz_string(data, size);
+    CJson_KeyTable *keys = cJson_CreateKeyTable();
+    CJson *base = cJson_Parse(text), *dup, *packed, *ws, *raw, *strict, *proj;
+    const char *all[1] = {""}, *paths[2] = {"/a", "/*/0"};
+    char *x, *y;
+    int i;
+
+    if (!cache) cache = cJson_CreateParseCache(64, 1 << 20);
+    if (!workspace) workspace = cJson_CreateWorkspace();
+    check_parse(base, parse_with(text, 1, NULL, 0, 0, 0), 0);
+    check_parse(base, parse_with(text, 0, keys, 0, 0, 0), 1);
+    check_parse(base, parse_with(text, 1, keys, 0, 0, 0), 0);
+    check_parse(base, parse_with(text, 0, NULL, 1, 0, 0), 0);
+    check_parse(base, cJson_ParseCached(cache, text), 1);
+    check_parse(base, cJson_ParseCached(cache, text), 1); // 第二次命中缓存
+    check_parse(base, parse_steps(text, 1 + size % 5), 1);
+    check_parse(base, cJson_ParseProjected(text, all, 1, NULL, NULL), 1);
+
+    // 投影解析：跳过的值同样做语法检查，结果与从完整的树里挑出来的相同
+    proj = cJson_ParseProjected(text, paths, 2, NULL, NULL);
+    FUZZ_CHECK(!base == !proj);
+    if (proj) {
+        dup = project(base);
+        FUZZ_CHECK(cJson_Equals(dup, proj));
+        cJson_Delete(dup);
+        cJson_Delete(proj);
+    }
+
+    // 紧凑数组：与普通的树相等、哈希相同，输出相同的文本
+    packed = parse_with(text, 0, NULL, 0, 1, 0);
+    FUZZ_CHECK(!base == !packed);
+    if (packed) {
+        FUZZ_CHECK(cJson_Equals(base, packed) && cJson_Equals(packed, base));
+        FUZZ_CHECK(cJson_Hash(base) == cJson_Hash(packed));
+        check_packed_numbers(base, packed);
+        check_same_print(base, packed);
+        dup = cJson_Duplicate(packed, 1);
+        check_same_print(base, dup);
+        cJson_Delete(dup);
+        cJson_Delete(packed);
+    }
+
+    // 原文片段：与普通的树相等、哈希相同，规范化输出相同；解码之后仍然相等
+    for (i = 0; i < 2; i++) {
+        raw = parse_with(text, i, NULL, 0, 0, 1);
+        strict = i ? parse_with(text, 1, NULL, 0, 0, 0) : NULL;
+        if (i) FUZZ_CHECK(!strict == !raw);
+        else FUZZ_CHECK(!base == !raw);
+        if (raw) {
+            FUZZ_CHECK(cJson_Equals(base, raw) && cJson_Equals(raw, base));
+            FUZZ_CHECK(cJson_Hash(base) == cJson_Hash(raw));
+            x = cJson_PrintCanonical(base);
+            y = cJson_PrintCanonical(raw);
+            FUZZ_CHECK(fuzz_same(x, y));
+            free(y);
+            if (!i) check_same_print(base, raw); // 宽松模式下原文片段不含转义，输出与解码后的相同
+            check_print(raw);
+            dup = cJson_Duplicate(raw, 1);
+            y = cJson_PrintCanonical(dup);
+            FUZZ_CHECK(fuzz_same(x, y));
+            free(y);
+            free(x);
+            cJson_Delete(dup);
+            if (!i) check_set_number(base, raw);
+        }
+        cJson_Delete(raw);
+        cJson_Delete(strict);
+    }
+
+    // 工作区：解析出相等的树，输出到工作区缓冲区的文本相同。失败的解析不影响之前的树
+    cJson_ResetWorkspace(workspace);
+    ws = cJson_ParseWorkspace(workspace, text, NULL, NULL);
+    FUZZ_CHECK(!base == !ws);
+    if (ws) {
+        FUZZ_CHECK(cJson_Equals(base, ws));
+        FUZZ_CHECK(!cJson_ParseWorkspace(workspace, "[1, \"xxxxxxxxxxxxxxxxxxxxxxxx\",", NULL, NULL));
+        x = cJson_Print(base);
+        FUZZ_CHECK(fuzz_same(x, cJson_PrintWorkspace(workspace, ws, 1)));
+        free(x);
+        x = cJson_PrintUnformatted(base);
+        FUZZ_CHECK(fuzz_same(x, cJson_PrintWorkspace(workspace, ws, 0)));
+        free(x);
+    }
+
+    if (base) {
+        check_print(base);
+        if (!fuzz_has_nonfinite(base)) check_stream(base);
+        dup = cJson_Duplicate(base, 1);
+        FUZZ_CHECK(cJson_Equals(base, dup));
+        check_print(dup);
+        check_set_number(base, dup);
+        cJson_Delete(dup);
+        dup = cJson_DuplicateShared(base);
+        check_print(dup);
+        cJson_Delete(dup);
+        dup = cJson_Duplicate(base, 1);
+        FUZZ_CHECK(cJson_FreezeObject(dup, 1));
+        check_frozen(base, dup);
+        check_print(dup);
+        cJson_Delete(dup);
+    }
+    cJson_Delete(base);
+    cJson_DeleteKeyTable(keys);
+    free(text);
+    return 0;
+}
@@ -0,0 +1,108 @@
+// 复制：深拷贝与原树相等；写时复制的副本按输入里的指令修改后原树不变，
+// 并且 cJson_Diff 生成的补丁能把原树的快照变成修改后的副本
+
+#include "fuzz.h"
+#include "cjson_utils.h"
+
+// 按 ops 指令沿着第一层或更深的路径修改 copy；每个字节是一条指令
+static void mutate(CJson *copy, const uint8_t *ops, size_t n) {
+    CJson *cur = copy, *child;
+    size_t i;
+    int type, index;
+
+    for (i = 0; i < n; i++) {
+        type = cur->type & 255;
+        if (type != CJSON_Array && type != CJSON_Object) cur = copy, type = copy->type & 255;
+        if (type != CJSON_Array && type != CJSON_Object) return;
+        index = ops[i] >> 3;
+        switch (ops[i] & 7) {
+            case 0: // 往下走一层
+                if ((child = cJson_GetArrayItemMutable(cur, index % (cJson_GetArraySize(cur) + 1)))) cur = child;
+                break;
+            case 1:
+                if (type == CJSON_Array) cJson_AddItemToArray(cur, cJson_CreateNumber(index));
+                else if (!cJson_GetObjectItemCaseSensitive(cur, "added")) cJson_AddItemToObject(cur, "added", cJson_CreateString("value"));
+                break;
+            case 2:
+                cJson_DeleteItemFromArray(cur, index % (cJson_GetArraySize(cur) + 1));
+                break;
+            case 3: // 下标越界时 newItem 不会被接管，只在范围内替换
+                if (cJson_GetArraySize(cur)) cJson_ReplaceItemInArray(cur, index % cJson_GetArraySize(cur), cJson_CreateArray());
+                break;
+            case 4:
+                cJson_InsertItemInArray(cur, index % (cJson_GetArraySize(cur) + 1), cJson_CreateNull());
+                break;
+            case 5:
+                if (type == CJSON_Object) cJson_DeleteItemFromObject(cur, "added");
+                break;
+            case 6:
+                if ((child = cJson_DetachItemFromArray(cur, index % (cJson_GetArraySize(cur) + 1)))) {
+                    cJson_AddItemToArray(cur, child);
+                }
+                break;
+            default:
+                cur = copy;
+                break;
+        }
+    }
+}
+
+// 有重复键名的对象无法用 JSON Pointer 准确定位，不做补丁检查。
+// 用 ReplaceItemInArray 换掉的对象成员没有键名，按 "" 算
+static int has_duplicate_keys(CJson *item) {
+    CJson *c, *d;
+    for (c = item->child; c; c = c->next) {
+        if ((item->type & 255) == CJSON_Object) {
+            for (d = c->next; d; d = d->next) {
+                if (!strcmp(c->string ? c->string : "", d->string ? d->string : "")) return 1;
+            }
+        }
+        if (has_duplicate_keys(c)) return 1;
+    }
+    return 0;
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    size_t split = size, opsLen = 0;
+    char *text, *before, *after;
+    CJson *json, *deep, *copy, *snapshot, *patch;
+
+    // 输入的最后 16 字节（不足时为全部之后的部分）作为修改指令
+    if (size > 16) split = size - 16, opsLen = 16;
+    text = fuzz_string(data, split);
+    json = cJson_Parse(text);
+    if (json && !fuzz_has_nonfinite(json)) {
+        deep = cJson_Duplicate(json, 1);
+        FUZZ_CHECK(cJson_Equals(json, deep));
+
+        before = cJson_PrintUnformatted(json);
+        copy = cJson_DuplicateShared(json);
+        snapshot = cJson_DuplicateShared(json);
+        FUZZ_CHECK(cJson_Equals(json, copy));
+        mutate(copy, data + split, opsLen);
+        after = cJson_PrintUnformatted(json);
+        FUZZ_CHECK(fuzz_same(before, after)); // 原树不受副本修改的影响
+        free(after);
+
+        if (!has_duplicate_keys(json) && !has_duplicate_keys(copy)) {
+            patch = cJson_Diff(json, copy);
+            FUZZ_CHECK(patch);
+            FUZZ_CHECK(cJson_ApplyPatch(snapshot, patch));
+            FUZZ_CHECK(cJson_Equals(snapshot, copy));
+            cJson_Delete(patch);
+        }
+
+        cJson_Delete(copy);
+        after = cJson_PrintUnformatted(deep); // 原树删除前后，深拷贝都独立
+        cJson_Delete(json);
+        json = NULL;
+        FUZZ_CHECK(fuzz_same(before, after));
+        free(after);
+        free(before);
+        cJson_Delete(snapshot);
+        cJson_Delete(deep);
+    }
+    cJson_Delete(json);
+    free(text);
+    return 0;
+}
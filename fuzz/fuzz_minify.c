@@ -0,0 +1,22 @@
+// 压缩：任意输入都不越界；合法的 JSON 压缩后解析结果不变
+
+#include "fuzz.h"
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    char *text = fuzz_string(data, size), *minified = fuzz_string(data, size);
+    CJson *before, *after;
+
+    cJson_Minify(minified);
+    FUZZ_CHECK(strlen(minified) <= strlen(text));
+    before = cJson_ParseWithOpts(text, NULL, 1);
+    if (before) {
+        after = cJson_ParseWithOpts(minified, NULL, 1);
+        FUZZ_CHECK(after);
+        FUZZ_CHECK(cJson_Equals(before, after));
+        cJson_Delete(after);
+        cJson_Delete(before);
+    }
+    free(minified);
+    free(text);
+    return 0;
+}
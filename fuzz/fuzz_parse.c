@@ -0,0 +1,93 @@
+// 解析：各种选项组合下的 cJson_ParseEx，以及 cJson_ParseStruct；成功时再输出一遍
+
+#include "fuzz.h"
+
+typedef struct Inner {
+    int id;
+    char tag[8];
+} Inner;
+
+typedef struct Outer {
+    int a;
+    double b;
+    int c;
+    char *s;
+    Inner inner;
+    int *ints;
+    int intCount;
+    Inner *items;
+    int itemCount;
+} Outer;
+
+static const CJson_Field innerFields[] = {
+    CJSON_BIND(Inner, id, CJSON_FIELD_INT),
+    CJSON_BIND_CHARS(Inner, tag)
+};
+static const CJson_Schema innerSchema = CJSON_SCHEMA(Inner, innerFields);
+
+static const CJson_Field intElem = CJSON_BIND_ELEM(CJSON_FIELD_INT, sizeof(int), NULL);
+static const CJson_Field innerElem = CJSON_BIND_ELEM(CJSON_FIELD_OBJECT, sizeof(Inner), &innerSchema);
+
+static const CJson_Field outerFields[] = {
+    CJSON_BIND(Outer, a, CJSON_FIELD_INT),
+    CJSON_BIND(Outer, b, CJSON_FIELD_DOUBLE),
+    CJSON_BIND(Outer, c, CJSON_FIELD_BOOL),
+    CJSON_BIND(Outer, s, CJSON_FIELD_STRING),
+    CJSON_BIND_OBJECT(Outer, inner, innerSchema),
+    CJSON_BIND_ARRAY(Outer, ints, intElem, intCount),
+    CJSON_BIND_ARRAY(Outer, items, innerElem, itemCount)
+};
+static const CJson_Schema outerSchema = CJSON_SCHEMA(Outer, outerFields);
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    CJson_ParseOptions opts;
+    CJson_KeyTable *keys = NULL;
+    const char *end = NULL;
+    CJson *json;
+    Outer out;
+    char *text, *printed;
+    int flags;
+
+    if (size < 1) return 0;
+    flags = data[0];
+    text = fuzz_string(data + 1, size - 1);
+
+    memset(&opts, 0, sizeof(opts));
+    opts.requireNullTerminated = flags & 1;
+    opts.strictStrings = (flags >> 1) & 1;
+    if (flags & 4) opts.maxDepth = 8;
+    if (flags & 8) opts.keys = keys = cJson_CreateKeyTable();
+    opts.packNumbers = (flags >> 5) & 1;
+    opts.rawStrings = (flags >> 6) & 1;
+    if (flags & 128) { // 很小的上限，让超限的路径都能走到
+        opts.maxNodes = 64;
+        opts.maxAllocBytes = 4096;
+        opts.maxStringLength = 16;
+        opts.maxMembers = 8;
+    }
+
+    json = cJson_ParseEx(text, &end, &opts);
+    if (json) {
+        FUZZ_CHECK(end && end >= text && end <= text + (size - 1));
+        printed = (flags & 16) ? cJson_Print(json) : cJson_PrintUnformatted(json);
+        FUZZ_CHECK(printed);
+        free(printed);
+        cJson_Delete(json);
+    } else {
+        FUZZ_CHECK(cJson_GetErrorPtr());
+        FUZZ_CHECK(cJson_GetErrorCode() != CJSON_ERROR_NONE && cJson_GetErrorCode() != CJSON_ERROR_MEMORY);
+        if (!(flags & 128)) FUZZ_CHECK(cJson_GetErrorCode() == CJSON_ERROR_SYNTAX || cJson_GetErrorCode() == CJSON_ERROR_DEPTH);
+    }
+
+    memset(&out, 0, sizeof(out));
+    if (cJson_ParseStruct(text, &outerSchema, &out, NULL, &opts)) {
+        printed = cJson_PrintStruct(&outerSchema, &out, flags & 16);
+        FUZZ_CHECK(printed);
+        free(printed);
+    }
+    cJson_FreeStruct(&outerSchema, &out);
+
+    cJson_DeleteKeyTable(keys);
+    free(text);
+    return 0;
+}
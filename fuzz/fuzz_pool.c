@@ -0,0 +1,96 @@
+// 内存池：装上 cJson_PoolHooks 之后解析、复制、修改、输出都和默认分配器下一样。
+// POSIX 平台上每个输入再起一个线程解析同一份文本：它的树由主线程释放，主线程的副本由它释放，
+// 它退出时线程缓存被销毁，之后线程局部变量的析构函数还会释放一棵树（走全局池）。
+// 工作线程运行期间主线程读取统计，结束后分配次数不少于释放次数
+
+#include "fuzz.h"
+#include "cjson_pool.h"
+#if defined(__unix__) || defined(__APPLE__)
+#define FUZZ_POOL_THREADS 1
+#include <pthread.h>
+#endif
+
+static CJson_Hooks hooks;
+
+#ifdef FUZZ_POOL_THREADS
+static pthread_key_t lateKey;
+
+typedef struct Job {
+    const char *text;
+    CJson *give; // 主线程的副本，由工作线程释放
+    CJson *result;
+} Job;
+
+static void late_delete(void *item) {
+    cJson_Delete((CJson *) item);
+}
+
+static void* worker(void *arg) {
+    Job *job = (Job *) arg;
+    job->result = cJson_Parse(job->text);
+    cJson_Delete(job->give);
+    pthread_setspecific(lateKey, cJson_Duplicate(job->result, 1));
+    return NULL;
+}
+#endif
+
+static void pool_init(void) {
+    cJson_PoolHooks(&hooks);
+    cJson_InitHooks(&hooks);
+#ifdef FUZZ_POOL_THREADS
+    // 池在第一次分配时创建自己的线程键，之后建的键析构得更晚，能覆盖线程缓存销毁之后的释放
+    cJson_Delete(cJson_CreateArray());
+    FUZZ_CHECK(pthread_key_create(&lateKey, late_delete) == 0);
+#endif
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    static int initialized;
+    char *text = fuzz_string(data, size), *before, *after;
+    CJson *json, *deep, *copy;
+
+    if (!initialized) {
+        pool_init();
+        initialized = 1;
+    }
+    json = cJson_Parse(text);
+    if (json) {
+        before = cJson_PrintUnformatted(json);
+        deep = cJson_Duplicate(json, 1);
+        copy = cJson_DuplicateShared(json);
+        FUZZ_CHECK(cJson_Equals(json, deep));
+        cJson_AddItemToArray(copy, cJson_CreateString("pool"));
+        cJson_AddItemToObject(copy, "pool", cJson_CreateNumber((double) size));
+        cJson_Delete(copy);
+        after = cJson_PrintUnformatted(json);
+        FUZZ_CHECK(fuzz_same(before, after));
+        hooks.free_fn(after);
+
+#ifdef FUZZ_POOL_THREADS
+        {
+            Job job;
+            pthread_t thread;
+            CJson_PoolStats stats;
+            job.text = text;
+            job.give = cJson_Duplicate(json, 1);
+            job.result = NULL;
+            FUZZ_CHECK(pthread_create(&thread, NULL, worker, &job) == 0);
+            cJson_GetPoolStats(&stats);
+            FUZZ_CHECK(pthread_join(thread, NULL) == 0);
+            cJson_GetPoolStats(&stats);
+            FUZZ_CHECK(stats.hits + stats.refills + stats.misses >= stats.frees);
+            FUZZ_CHECK(stats.large >= stats.largeFrees);
+            FUZZ_CHECK(cJson_Equals(json, job.result));
+            cJson_Delete(job.result);
+        }
+#endif
+        after = cJson_PrintUnformatted(deep);
+        FUZZ_CHECK(fuzz_same(before, after));
+        hooks.free_fn(after);
+        hooks.free_fn(before);
+        cJson_Delete(deep);
+    }
+    cJson_Delete(json);
+    free(text);
+    return 0;
+}
@@ -0,0 +1,33 @@
+// 输出再解析：紧凑/格式化/规范化输出重新解析后与原树相等，且第二轮输出与第一轮相同
+
+#include "fuzz.h"
+
+static void check_roundtrip(CJson *json, char *(*print)(CJson *)) {
+    char *first = print(json), *second;
+    CJson *again;
+
+    FUZZ_CHECK(first);
+    again = cJson_ParseWithOpts(first, NULL, 1);
+    FUZZ_CHECK(again);
+    FUZZ_CHECK(cJson_Equals(json, again));
+    FUZZ_CHECK(cJson_Hash(json) == cJson_Hash(again));
+    second = print(again);
+    FUZZ_CHECK(fuzz_same(first, second));
+    free(first);
+    free(second);
+    cJson_Delete(again);
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    char *text = fuzz_string(data, size);
+    CJson *json = cJson_Parse(text);
+
+    if (json && !fuzz_has_nonfinite(json)) {
+        check_roundtrip(json, cJson_PrintUnformatted);
+        check_roundtrip(json, cJson_Print);
+        check_roundtrip(json, cJson_PrintCanonical);
+    }
+    cJson_Delete(json);
+    free(text);
+    return 0;
+}
@@ -1,47 +1,414 @@
+#if defined(CJSON_ENABLE_STATS) && !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200112L // clock_gettime
+#endif
+
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <limits.h>
 #include <ctype.h>
 #include <float.h>
+#include <stdint.h>
+#include <locale.h>
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/uio.h>
+#include <unistd.h>
+#include <errno.h>
+#endif
+#ifdef CJSON_ENABLE_STATS
+#include <time.h>
+#endif
 #include "cjson.h"
 
 /* -------------------------------------------------------------------------- */
 /*                                 parameters                                 */
 /* -------------------------------------------------------------------------- */
 
+// 分段输出模式下的池化缓冲区，数据紧随结构体之后
+typedef struct SegmentChunk {
+    struct SegmentChunk *next;
+    int size;
+} SegmentChunk;
+
+// 格式化输出时预先拼好的“换行 + 若干层缩进”的长度，以及换行符、一层缩进、冒号后空白各自的长度上限
+#define CJSON_LINE_BUFFER 128
+#define CJSON_INDENT_MAX 32
+
 typedef struct {
     char *buffer;
     int length;
     int offset;
+    CJson_Segments *segs; // 非空时为分段输出模式，buffer 指向 chunk 的数据区
+    SegmentChunk *chunk;
+    int runStart; // 当前 chunk 中尚未提交为分段的起点
+    int canonical; // RFC 8785 规范化输出：键名排序，数字用最短的往返表示
+    CJson_Workspace *ws; // 非空时输出栈从工作区借用，用完交还
+
+    // 格式化输出的排版（print_format）：line 是换行符后跟 lineDepth 层缩进，换行时整段 memcpy
+    const char *line;
+    int newlineLen, indentLen, lineDepth;
+    char colon[CJSON_INDENT_MAX + 2];
+    int colonLen;
+    int arrayLines;  // 数组元素也各占一行
+    int emptyBraces; // 空对象写成 {}，否则照旧写成换行隔开的一对括号
+    char lineBuf[CJSON_LINE_BUFFER];
 } PrintBuffer;
 
+// 显式栈先用的定长数组的大小，嵌套更深时换到堆上
+#define CJSON_LOCAL_FRAMES 32
+
+// 输出栈的一层。规范化输出时，对象的成员按键名排好序放在 sorted 里，按 index 依次输出
+typedef struct {
+    CJson *container;
+    CJson **sorted;
+    int index;
+    int count;
+} PrintFrame;
+
+// 投影解析（cJson_ParseProjected）的路径前缀树的一个节点。child/next 是节点数组中的下标，-1 表示没有
+typedef struct {
+    const char *key; // 解码后的一段路径，不以 0 结尾
+    int len;
+    long index;      // key 是数组下标时的值，否则为 -1
+    int wildcard;    // "*"：匹配任何成员
+    int all;         // 有路径在这里结束，整个值都保留
+    int child;
+    int next;
+} ProjNode;
+
+typedef struct {
+    ProjNode *nodes; // nodes[0] 是根
+    int count;
+    int capacity;
+    char *keys;      // 各段路径解码后的内容
+} Projection;
+
+// 解析栈的一层：正在解析的 Array/Object 和它最后一个子节点。
+// 投影解析时 proj 是容器在前缀树中对应的节点（NULL 表示整个保留），index 是已经看过的成员数
+typedef struct {
+    CJson *container;
+    CJson *last;
+    const ProjNode *proj;
+    long index;
+} ParseFrame;
+
+// 解析上下文，由 CJson_ParseOptions 初始化。解析过程是一个显式的状态机，
+// 嵌套的数组/对象压在 stack 上而不是递归，状态都保存在这里
+typedef struct {
+    CJson_KeyTable *keys;
+    int maxDepth;
+    int strictStrings;
+    int packNumbers;
+    int rawStrings;
+    CJson_Workspace *ws; // 非空时节点和字符串从工作区分配，栈也从工作区借用
+    const ProjNode *projNodes; // 投影解析的前缀树，NULL 表示不投影
+    const ProjNode *curProj;   // 下一个值是容器时，它在前缀树中对应的节点
+
+    const char *ptr; // 当前位置
+    CJson *cur;      // 下一个值写入的节点
+    ParseFrame *stack;
+    int depth;
+    int stackSize;
+    ParseFrame local[CJSON_LOCAL_FRAMES];
+
+    // 对象成员的键名先于值解析，等值解析完、知道节点类型后再放到节点上
+    CJson key;
+    int hasKey;
+    const char *internedKey;
+
+    // 分步解析（cJson_ParseStep）的预算：这一步从 stepStart 开始，最多处理 maxBytes 字节（0 表示不限）、
+    // nodesLeft 个值，用完时 parse_run 在两个值之间停下
+    int budget;
+    const char *stepStart;
+    size_t maxBytes;
+    size_t nodesLeft;
+
+    // 资源上限（CJson_ParseOptions 的 max*），不限时取最大值，热路径上只需比较。
+    // 节点数和分配的字节数是剩余的额度，从整个解析的开头算起
+    size_t nodeQuota;
+    size_t byteQuota;
+    size_t maxString;
+    long maxMembers;
+} ParseContext;
+
+// 分步解析的状态。c.cur 等在两次 cJson_ParseStep 之间保持不变，未完成的部分已经挂在 root 下
+struct CJson_Parser {
+    ParseContext c;
+    CJson *root;
+    int requireNullTerminated;
+    int state; // CJSON_PARSE_*
+};
+
+// cJson_Hash 的一层：正在合并子节点哈希的 Array/Object
+typedef struct {
+    CJson *container;
+    uint64_t acc;
+} HashFrame;
+
+// 键名驻留表的一项，str 紧随其后；哈希在插入时算好并保存
+typedef struct KeyEntry {
+    uint64_t hash;
+    size_t len;
+} KeyEntry;
+
+struct CJson_KeyTable {
+    KeyEntry **slots; // 开放寻址，容量为 2 的幂
+    size_t capacity;
+    size_t count;
+};
+
+// 工作区的一块内存，数据紧随结构体之后
+typedef struct WorkspaceBlock {
+    struct WorkspaceBlock *next;
+    size_t size;
+} WorkspaceBlock;
+
+// 工作区：节点和字符串从块里顺序划出，重置时只把位置移回开头，块都留着。
+// 解析栈、输出栈和输出缓冲区用完后也留在这里，下次接着用
+struct CJson_Workspace {
+    WorkspaceBlock *blocks;
+    WorkspaceBlock *cur; // 正在划分的块，NULL 表示还没开始；它之后的块是上一轮留下的
+    size_t used;         // cur 中已用的字节数
+    ParseFrame *parseStack;
+    int parseStackSize;
+    PrintFrame *printStack;
+    int printStackSize;
+    char *out;
+    int outSize;
+};
+
+// 工作区第一块的大小，之后每块翻倍
+#define CJSON_WORKSPACE_BLOCK 4096
+
+// 分段输出时，不含转义且长度不小于该值的字符串直接引用，不拷贝
+#define CJSON_SEGMENT_REF_MIN 64
+#define CJSON_SEGMENT_CHUNK 4096
+
+// 成员少于该值的对象不冻结，线性查找更快
+#define CJSON_FREEZE_MIN 8
+
+// 线程局部变量（统计计数）
+#if defined(_MSC_VER)
+#define CJSON_TLS __declspec(thread)
+#elif defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L && !defined(__STDC_NO_THREADS__)
+#define CJSON_TLS _Thread_local
+#else
+#define CJSON_TLS __thread
+#endif
+
 static void *(*cJson_malloc)(size_t sz) = malloc;
 static void (*cJson_free)(void *ptr) = free;
 
 static const char *ep;
+static int ec; // 最近一次解析失败的原因，CJSON_ERROR_*
 
 static const unsigned char firstByteMark[7] = {
     0x00, 0x00, 0xC0, 0xE0, 0xF0, 0xF8, 0xFC
 };
 
+// 十六进制字符的值，其它字符为 -1
+static const signed char hexValue[256] = {
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+     0,  1,  2,  3,  4,  5,  6,  7,  8,  9, -1, -1, -1, -1, -1, -1,
+    -1, 10, 11, 12, 13, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, 10, 11, 12, 13, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1
+};
+
+static const char hexDigits[] = "0123456789abcdef";
+
+// 10^0..10^22 都能用 double 精确表示
+static const double pow10Table[23] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+// 统计计数（-DCJSON_ENABLE_STATS）。计数都是线程局部的；关闭时下面的宏展开为空，不留任何代码。
+// STATS_BEGIN/STATS_END 包住一次公开的解析/输出调用，嵌套调用只算最外层
+#ifdef CJSON_ENABLE_STATS
+static CJSON_TLS CJson_Stats statsTotal;
+static CJSON_TLS CJson_Stats statsLast;
+static CJSON_TLS CJson_Stats statsBefore; // 最外层调用开始时的 statsTotal
+static CJSON_TLS uint64_t statsStart;
+static CJSON_TLS int statsNesting;
+static CJSON_TLS int statsCallDepth;
+
+#define STAT_ADD(field, n) (statsTotal.field += (n))
+#define STAT_DEPTH(d) ((d) > statsCallDepth ? (void) (statsCallDepth = (d)) : (void) 0)
+#define STATS_BEGIN() stats_begin()
+#define STATS_END(print, ctx) stats_end(print, ctx)
+#else
+#define STAT_ADD(field, n) ((void) 0)
+#define STAT_DEPTH(d) ((void) 0)
+#define STATS_BEGIN() ((void) 0)
+#define STATS_END(print, ctx) ((void) 0)
+#endif
+
 /* -------------------------------------------------------------------------- */
 /*                              static functions                              */
 /* -------------------------------------------------------------------------- */
 
+#ifdef CJSON_ENABLE_STATS
+static uint64_t stats_now(void) {
+#ifdef _WIN32
+    return (uint64_t) clock() * (1000000000 / CLOCKS_PER_SEC);
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000u + (uint64_t) ts.tv_nsec;
+#endif
+}
+
+static void stats_begin(void) {
+    if (statsNesting++) return;
+    statsBefore = statsTotal;
+    statsCallDepth = 0;
+    statsStart = stats_now();
+}
+
+// 结束一次调用：算出这次的增量，存为 statsLast，ctx 非空时再累加到 ctx 上
+static void stats_end(int print, CJson_Stats *ctx) {
+    uint64_t ns;
+    CJson_Stats d;
+    if (--statsNesting) return;
+    ns = stats_now() - statsStart;
+    if (print) statsTotal.prints++, statsTotal.printNs += ns;
+    else statsTotal.parses++, statsTotal.parseNs += ns;
+    if (statsCallDepth > statsTotal.maxDepth) statsTotal.maxDepth = statsCallDepth;
+
+    d.nodes = statsTotal.nodes - statsBefore.nodes;
+    d.stringBytes = statsTotal.stringBytes - statsBefore.stringBytes;
+    d.reallocs = statsTotal.reallocs - statsBefore.reallocs;
+    d.bytesCopied = statsTotal.bytesCopied - statsBefore.bytesCopied;
+    d.maxDepth = statsCallDepth;
+    d.parses = statsTotal.parses - statsBefore.parses;
+    d.prints = statsTotal.prints - statsBefore.prints;
+    d.parseNs = statsTotal.parseNs - statsBefore.parseNs;
+    d.printNs = statsTotal.printNs - statsBefore.printNs;
+    statsLast = d;
+    if (!ctx) return;
+    ctx->nodes += d.nodes;
+    ctx->stringBytes += d.stringBytes;
+    ctx->reallocs += d.reallocs;
+    ctx->bytesCopied += d.bytesCopied;
+    if (d.maxDepth > ctx->maxDepth) ctx->maxDepth = d.maxDepth;
+    ctx->parses += d.parses;
+    ctx->prints += d.prints;
+    ctx->parseNs += d.parseNs;
+    ctx->printNs += d.printNs;
+}
+#endif
+
 static CJson* cJson_new_item(void) {
     CJson *nd = (CJson*) cJson_malloc(sizeof(CJson));
-    if (nd) memset(nd, 0x00, sizeof(CJson));
+    if (nd) {
+        memset(nd, 0x00, sizeof(CJson));
+        STAT_ADD(nodes, 1);
+    }
     return nd;
 }
 
-static char* cJson_strdup(const char* str) {
-    size_t len;
-    char *copy;
-    len = strlen(str) + 1;
-    if (!(copy = (char*) cJson_malloc(len))) return NULL;
+// iValue 跟随 dValue，超出 int 范围时取边界值（直接转换是未定义行为）
+static int double_to_int(double d) {
+    if (d >= INT_MAX) return INT_MAX;
+    if (d <= INT_MIN) return INT_MIN;
+    if (d != d) return 0;
+    return (int) d;
+}
+
+// ptr 是否指向 item 自己的内联存储
+static int is_inline(const CJson *item, const char *ptr) {
+    return (item->type & cJson_IsInlineString) && ptr >= item->inlineBuf && ptr < item->inlineBuf + CJSON_INLINE_SIZE;
+}
+
+// 在 item 的内联存储中划出 n 字节，放不下或 item 的数值存储区有用时返回 NULL。
+// 原文片段的长度占着 iValue，只能用其余的部分
+static char* inline_alloc(CJson *item, size_t n) {
+    size_t used = (item->type & cJson_IsRawString) ? sizeof(item->iValue) : 0, end;
+    int type = item->type & 255;
+    if (type == CJSON_Number || type == CJSON_Array || type == CJSON_Object) return NULL;
+    if (is_inline(item, item->sValue)) {
+        used = item->sValue - item->inlineBuf + strlen(item->sValue) + 1;
+    }
+    if (is_inline(item, item->string)) {
+        end = item->string - item->inlineBuf + strlen(item->string) + 1;
+        if (end > used) used = end;
+    }
+    if (used + n > CJSON_INLINE_SIZE) return NULL;
+    item->type |= cJson_IsInlineString;
+    return item->inlineBuf + used;
+}
+
+// 短字符串内联到 item 中，否则复制到堆上
+static char* cJson_strdup_inline(CJson *item, const char *str) {
+    size_t len = strlen(str) + 1;
+    char *copy = inline_alloc(item, len);
+    if (!copy) {
+        if (!(copy = (char *) cJson_malloc(len))) return NULL;
+        STAT_ADD(stringBytes, len);
+    }
     memcpy(copy, str, len);
     return copy;
 }
 
+static int unescape(const char *ptr, const char *end, int escapes, char *out);
+
+// 把原文片段解码成 item 自己的字符串（短的内联），调用前 item 上要先去掉 cJson_IsRawString
+static char* raw_to_string(CJson *item, const char *raw, int len, int escapes) {
+    char *out = inline_alloc(item, len + 1); // 解码后不会变长
+    if (!out) {
+        if (!(out = (char *) cJson_malloc(len + 1))) return NULL;
+        STAT_ADD(stringBytes, len + 1);
+    }
+    unescape(raw, raw + len, escapes, out);
+    return out;
+}
+
+// 原文片段在第一次取值时就地解码，之后就是普通的字符串节点。引用节点解码后拥有自己的字符串，不再是引用
+static int materialize(CJson *item) {
+    const char *raw = item->sValue;
+    int len = item->iValue, type = item->type;
+    char *out;
+
+    if (!(type & cJson_IsRawString)) return 1;
+    item->type &= ~(cJson_IsRawString | cJson_HasEscapes | cJson_IsReference); // 内联的键名不动
+    if (!(out = raw_to_string(item, raw, len, type & cJson_HasEscapes))) {
+        item->type = type;
+        return 0;
+    }
+    item->sValue = out;
+    return 1;
+}
+
+// 字符串节点的内容和长度，不修改 item：原文片段中有转义时解码到 *tmp（用完 cJson_free），
+// 否则直接指向原文。内存不足时返回 NULL
+static const char* string_view(CJson *item, size_t *len, char **tmp) {
+    *tmp = NULL;
+    if (!(item->type & cJson_IsRawString)) {
+        *len = item->sValue ? strlen(item->sValue) : 0;
+        return item->sValue ? item->sValue : "";
+    }
+    if (!(item->type & cJson_HasEscapes)) {
+        *len = item->iValue;
+        return item->sValue;
+    }
+    if (!(*tmp = (char *) cJson_malloc(item->iValue + 1))) return NULL;
+    *len = unescape(item->sValue, item->sValue + item->iValue, 1, *tmp);
+    return *tmp;
+}
+
 static void suffix_object(CJson *prev, CJson *item) {
     prev->next = item;
     item->prev = prev;
@@ -57,10 +424,108 @@ static int cJson_strcasecmp(const char *s1, const char *s2) {
 }
 
 static const char* skip(const char *in) {
-    while (in && *in && (unsigned char) *in <= 32) ++in;
+    if (!in) return NULL;
+    while ((unsigned char) (*in - 1) < 32) ++in; // 1 到 32，不跳过结尾的 0
     return in;
 }
 
+// 一次检查 8 个字节。按字对齐地读取不会跨页，但可能读到结尾的 0 之后、同一个字里的几个字节，
+// 所以对 ASan 关闭检查
+#if defined(__GNUC__) || defined(__clang__)
+#define CJSON_SWAR 1
+typedef uint64_t __attribute__((may_alias)) cJson_word;
+typedef uint32_t __attribute__((may_alias, aligned(1))) cJson_word32;
+#define ONES  0x0101010101010101ULL
+#define HIGHS 0x8080808080808080ULL
+#define HAS_ZERO(x)    (((x) - ONES) & ~(x) & HIGHS)
+#define HAS_LESS(x, n) (((x) - ONES * (n)) & ~(x) & HIGHS)
+__attribute__((no_sanitize_address))
+#endif
+// 跳过字符串中不需要特殊处理的字节，停在 '"'、'\\'、控制字符（含结尾的 0）上；
+// stopHigh 时也停在 >= 0x80 的字节上
+static const char* scan_plain(const char *ptr, int stopHigh) {
+    unsigned char ch;
+#ifdef CJSON_SWAR
+    uint64_t v, m;
+    while ((uintptr_t) ptr & 7) {
+        ch = (unsigned char) *ptr;
+        if (ch < 0x20 || ch == '\"' || ch == '\\' || (stopHigh && ch >= 0x80)) return ptr;
+        ++ptr;
+    }
+    while (1) {
+        v = *(const cJson_word *) ptr;
+        m = HAS_LESS(v, 0x20) | HAS_ZERO(v ^ (ONES * '\"')) | HAS_ZERO(v ^ (ONES * '\\'));
+        if (stopHigh) m |= v & HIGHS;
+        if (m) break;
+        ptr += 8;
+    }
+#endif
+    while (1) {
+        ch = (unsigned char) *ptr;
+        if (ch < 0x20 || ch == '\"' || ch == '\\' || (stopHigh && ch >= 0x80)) return ptr;
+        ++ptr;
+    }
+}
+
+// 值的第一个字节决定它的类型，解析时按这张表分派；表中的值是下面的 VALUE_*
+enum {
+    VALUE_INVALID = 0,
+    VALUE_STRING,
+    VALUE_NUMBER,
+    VALUE_TRUE,
+    VALUE_FALSE,
+    VALUE_NULL,
+    VALUE_ARRAY,
+    VALUE_OBJECT
+};
+
+static const unsigned char valueClass[256] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 0, 0,
+    2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 6, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 4, 0, 0, 0, 0, 0, 0, 0, 5, 0,
+    0, 0, 0, 0, 3, 0, 0, 0, 0, 0, 0, 7, 0, 0, 0, 0
+};
+
+// ptr 处的 4 个字节是否等于字面量 lit 的前 4 个字节。不跨页时整字比较（可能读到结尾的 0 之后，
+// 同 scan_plain），否则逐字节比较，遇到结尾的 0 就停下
+#ifdef CJSON_SWAR
+__attribute__((no_sanitize_address))
+#endif
+static int match4(const char *ptr, const char *lit) {
+#ifdef CJSON_SWAR
+    if (((uintptr_t) ptr & 4095) <= 4092) return *(const cJson_word32 *) ptr == *(const cJson_word32 *) lit;
+#endif
+    return ptr[0] == lit[0] && ptr[1] == lit[1] && ptr[2] == lit[2] && ptr[3] == lit[3];
+}
+
+// 校验 ptr 处的一个多字节 UTF-8 序列（RFC 3629：拒绝过长编码、代理区和大于 U+10FFFF 的码点），
+// 返回其后的位置，无效时返回 NULL
+static const char* check_utf8(const char *ptr) {
+    const unsigned char *s = (const unsigned char *) ptr;
+    unsigned char lo = 0x80, hi = 0xBF;
+    int n;
+
+    if (s[0] >= 0xC2 && s[0] <= 0xDF) n = 1;
+    else if (s[0] >= 0xE0 && s[0] <= 0xEF) {
+        n = 2;
+        if (s[0] == 0xE0) lo = 0xA0;
+        else if (s[0] == 0xED) hi = 0x9F;
+    } else if (s[0] >= 0xF0 && s[0] <= 0xF4) {
+        n = 3;
+        if (s[0] == 0xF0) lo = 0x90;
+        else if (s[0] == 0xF4) hi = 0x8F;
+    } else return NULL;
+
+    if (s[1] < lo || s[1] > hi) return NULL;
+    if (n >= 2 && (s[2] & 0xC0) != 0x80) return NULL;
+    if (n == 3 && (s[3] & 0xC0) != 0x80) return NULL;
+    return ptr + n + 1;
+}
+
 static CJson* create_reference(CJson *item) {
     CJson *ref = cJson_new_item();
     if (!ref) return 0;
@@ -68,9 +533,48 @@ static CJson* create_reference(CJson *item) {
     ref->string = 0;
     ref->type |= cJson_IsReference;
     ref->next = ref->prev = NULL;
+    ref->shareCount = 0;
+    if (is_inline(item, item->sValue)) ref->sValue = ref->inlineBuf + (item->sValue - item->inlineBuf);
+    if (item->type & cJson_IsFrozen) { // 原节点解冻时会释放索引，引用不能跟着用
+        ref->type &= ~cJson_IsFrozen;
+        ref->sValue = NULL;
+        ref->iValue = 0;
+    }
     return ref;
 }
 
+// 共享子链表的引用计数，可能被多个线程里的副本同时增减
+#if defined(__GNUC__) || defined(__clang__)
+#define share_load(p)   __atomic_load_n(p, __ATOMIC_ACQUIRE)
+#define share_add(p, n) __atomic_fetch_add(p, n, __ATOMIC_ACQ_REL)
+#else
+#define share_load(p)   (*(p))
+#define share_add(p, n) ((*(p) += (n)) - (n))
+#endif
+
+static void share_acquire(CJson *head) {
+    share_add(&head->shareCount, 1);
+}
+
+// 放弃对以 head 开头的子链表的持有，返回 1 表示调用者是最后一个持有者，应当释放它
+static int share_release(CJson *head) {
+    if (!share_load(&head->shareCount)) return 1;
+    if (share_add(&head->shareCount, -1) > 0) return 0;
+    head->shareCount = 0; // 其它持有者在这期间都已经放弃
+    return 1;
+}
+
+// 显式栈已满时扩容一倍：一开始用调用者提供的定长数组 local，之后换到堆上
+static int stack_grow(void **stack, int *size, size_t elemSize, void *local) {
+    void *newStack = cJson_malloc(*size * 2 * elemSize);
+    if (!newStack) return 0;
+    memcpy(newStack, *stack, *size * elemSize);
+    if (*stack != local) cJson_free(*stack);
+    *stack = newStack;
+    *size *= 2;
+    return 1;
+}
+
 // 大于等于 x 的最小2的幂
 static int pow2gt(int x) {
     --x;
@@ -89,13 +593,85 @@ static int update(PrintBuffer *p) {
     return p->offset + strlen(str);
 }
 
+static int segments_push(CJson_Segments *segs, const void *base, size_t len) {
+    CJson_Segment *newSegs;
+    int newCap;
+    if (!len) return 1;
+    if (segs->count == segs->capacity) {
+        newCap = segs->capacity ? segs->capacity * 2 : 16;
+        newSegs = (CJson_Segment *) cJson_malloc(newCap * sizeof(CJson_Segment));
+        if (!newSegs) return 0;
+        if (segs->segs) {
+            memcpy(newSegs, segs->segs, segs->count * sizeof(CJson_Segment));
+            cJson_free(segs->segs);
+        }
+        segs->segs = newSegs;
+        segs->capacity = newCap;
+    }
+    segs->segs[segs->count].base = base;
+    segs->segs[segs->count].len = len;
+    segs->count++;
+    return 1;
+}
+
+// 把当前 chunk 中 [runStart, offset) 提交为一个分段
+static int segments_commit(PrintBuffer *p) {
+    if (!segments_push(p->segs, p->buffer + p->runStart, p->offset - p->runStart)) {
+        p->buffer = NULL;
+        return 0;
+    }
+    p->runStart = p->offset;
+    return 1;
+}
+
+// 切换到下一个至少能容纳 needed 字节的 chunk，优先复用上一次输出留下的 chunk
+static char* segments_next_chunk(PrintBuffer *p, int needed) {
+    SegmentChunk *c = p->chunk ? p->chunk->next : (SegmentChunk *) p->segs->chunks;
+    SegmentChunk *prev = p->chunk;
+    int size = needed > CJSON_SEGMENT_CHUNK ? needed : CJSON_SEGMENT_CHUNK;
+
+    if (!c || c->size < needed) {
+        c = (SegmentChunk *) cJson_malloc(sizeof(SegmentChunk) + size);
+        if (!c) return NULL;
+        c->size = size;
+        if (prev) {
+            c->next = prev->next;
+            prev->next = c;
+        } else {
+            c->next = (SegmentChunk *) p->segs->chunks;
+            p->segs->chunks = c;
+        }
+    }
+    p->chunk = c;
+    p->buffer = (char *) (c + 1);
+    p->length = c->size;
+    p->offset = p->runStart = 0;
+    return p->buffer;
+}
+
 static char* ensure(PrintBuffer *p, int needed) {
     char *newBuffer;
     int newSize;
     if (!p || !p->buffer) return 0;
+
+    if (p->segs) { // 分段模式下不搬移已写出的数据，而是换一个新的 chunk
+        if (p->offset + needed <= p->length) return p->buffer + p->offset;
+        if (!segments_commit(p) || !segments_next_chunk(p, needed)) {
+            p->buffer = NULL;
+            return NULL;
+        }
+        STAT_ADD(reallocs, 1);
+        return p->buffer;
+    }
     
     needed += p->offset;
     if (needed <= p->length) return p->buffer + p->offset;
+    if (needed < 0 || needed > (INT_MAX >> 1) + 1) { // pow2gt 会溢出
+        cJson_free(p->buffer);
+        p->length = 0;
+        p->buffer = NULL;
+        return NULL;
+    }
 
     newSize = pow2gt(needed);
     newBuffer = (char *) cJson_malloc(newSize);
@@ -109,6 +685,8 @@ static char* ensure(PrintBuffer *p, int needed) {
     //     memcpy(newBuffer, p->buffer, p->length);
     // }
     memcpy(newBuffer, p->buffer, p->length);
+    STAT_ADD(reallocs, 1);
+    STAT_ADD(bytesCopied, p->length);
     cJson_free(p->buffer);
     p->length = newSize;
     p->buffer = newBuffer;
@@ -156,16 +734,53 @@ CJson* cJson_CreateNumber(double num) {
     if (item) {
         item->type = CJSON_Number;
         item->dValue = num;
-        item->iValue = (int) num;
+        item->iValue = double_to_int(num);
     }
     return item;
 }
 
+static char* heap_copy(const char *str) {
+    size_t len = strlen(str) + 1;
+    char *copy = (char *) cJson_malloc(len);
+    if (copy) {
+        memcpy(copy, str, len);
+        STAT_ADD(stringBytes, len);
+    }
+    return copy;
+}
+
+// 数值存储区被内联字符串或原文片段的长度占着时，先把字符串搬到堆上，腾出 iValue/dValue
+static int spill_inline(CJson *item) {
+    char *value = NULL, *key = NULL;
+    if (!materialize(item)) return 0;
+    if (!(item->type & cJson_IsInlineString)) return 1;
+    if (is_inline(item, item->sValue) && !(value = heap_copy(item->sValue))) return 0;
+    if (is_inline(item, item->string) && !(key = heap_copy(item->string))) {
+        cJson_free(value);
+        return 0;
+    }
+    if (value) {
+        item->sValue = value;
+        item->type &= ~cJson_IsReference; // 搬出来的副本归自己
+    }
+    if (key) item->string = key;
+    item->type &= ~cJson_IsInlineString;
+    return 1;
+}
+
+// 紧凑数组和冻结对象的 iValue 是元素个数，不改；内存不足时同样不改
+double cJson_SetNumberHelper(CJson *object, double number) {
+    if ((object->type & (cJson_IsPacked | cJson_IsFrozen)) || !spill_inline(object)) return number;
+    object->dValue = number;
+    object->iValue = double_to_int(number);
+    return number;
+}
+
 CJson* cJson_CreateString(const char *string) {
     CJson *item = cJson_new_item();
     if (item) {
         item->type = CJSON_String;
-        item->sValue = cJson_strdup(string);
+        item->sValue = cJson_strdup_inline(item, string);
     }
     return item;
 }
@@ -250,13 +865,172 @@ CJson* cJson_CreateStringArray(const char **strings, int count) {
     return a;
 }
 
+CJson* cJson_CreatePackedArray(const double *numbers, int count) {
+    CJson *a = cJson_CreateArray();
+    if (!a || count <= 0) return a;
+    a->sValue = (char *) cJson_malloc(count * sizeof(double));
+    if (!a->sValue) {
+        cJson_Delete(a);
+        return NULL;
+    }
+    memcpy(a->sValue, numbers, count * sizeof(double));
+    a->iValue = count;
+    a->type |= cJson_IsPacked;
+    return a;
+}
+
+// 紧凑数组展开成数字节点。引用节点展开后拥有自己的子节点，不再是引用
+static int unpack(CJson *array) {
+    const double *values = (const double *) array->sValue;
+    CJson *head = NULL, *prev = NULL, *n;
+    int i;
+
+    if (!(array->type & cJson_IsPacked)) return 1;
+    for (i = 0; i < array->iValue; i++) {
+        if (!(n = cJson_CreateNumber(values[i]))) {
+            cJson_Delete(head);
+            return 0;
+        }
+        if (prev) suffix_object(prev, n);
+        else head = n;
+        prev = n;
+    }
+    if (!(array->type & cJson_IsReference)) cJson_free(array->sValue);
+    array->type &= ~(cJson_IsPacked | cJson_IsReference);
+    array->sValue = NULL;
+    array->iValue = 0;
+    array->dValue = 0;
+    array->child = head;
+    return 1;
+}
+
+int cJson_UnpackArray(CJson *array) {
+    return array ? unpack(array) : 0;
+}
+
+static CJson** sort_members(CJson *object, int *count, int (*compare)(const void *, const void *));
+
+// 冻结对象的成员顺序：与 cJson_strcasecmp 的相等关系一致，没有键名的排在最前
+static int compare_keys_nocase(const void *x, const void *y) {
+    const char *a = (*(CJson * const *) x)->string, *b = (*(CJson * const *) y)->string;
+    if (!a || !b) return (a != NULL) - (b != NULL);
+    return cJson_strcasecmp(a, b);
+}
+
+// 结构改变之前丢掉冻结对象的有序索引
+static void thaw(CJson *object) {
+    if (!(object->type & cJson_IsFrozen)) return;
+    cJson_free(object->sValue);
+    object->sValue = NULL;
+    object->iValue = 0;
+    object->type &= ~cJson_IsFrozen;
+}
+
+// 冻结对象中第一个（原来的顺序里最靠前的）键名不区分大小写等于 string 的成员，二分查找
+static CJson* frozen_find(CJson *object, const char *string, int caseSensitive) {
+    CJson **index = (CJson **) object->sValue, **end = index + object->iValue;
+    int lo = 0, hi = object->iValue, mid;
+
+    while (lo < hi) {
+        mid = lo + (hi - lo) / 2;
+        if (!index[mid]->string || cJson_strcasecmp(index[mid]->string, string) < 0) lo = mid + 1;
+        else hi = mid;
+    }
+    // 排序是稳定的，相等的键名保持原来的先后
+    for (index += lo; index < end && !cJson_strcasecmp((*index)->string, string); ++index) {
+        if (!caseSensitive || !strcmp((*index)->string, string)) return *index;
+    }
+    return NULL;
+}
+
+int cJson_FreezeObject(CJson *item, int recursive) {
+    CJson *local[CJSON_LOCAL_FRAMES], **stack = local, **sorted, *c;
+    int depth = 0, size = CJSON_LOCAL_FRAMES, count, ok = 1;
+
+    if (!item) return 0;
+    stack[depth++] = item;
+    while (depth) {
+        item = stack[--depth];
+        if (item->type & cJson_IsReference) continue; // 子节点属于原节点
+        for (c = item->child, count = 0; c && count < CJSON_FREEZE_MIN; c = c->next) ++count;
+        if ((item->type & 255) == CJSON_Object && count == CJSON_FREEZE_MIN && !(item->type & cJson_IsFrozen)) {
+            if (!(sorted = sort_members(item, &count, compare_keys_nocase))) {
+                ok = 0;
+                break;
+            }
+            // sort_members 用了两倍的空间，只留下排好的一半
+            if (!(item->sValue = (char *) cJson_malloc(count * sizeof(CJson *)))) {
+                cJson_free(sorted);
+                ok = 0;
+                break;
+            }
+            memcpy(item->sValue, sorted, count * sizeof(CJson *));
+            cJson_free(sorted);
+            item->iValue = count;
+            item->type |= cJson_IsFrozen;
+        }
+        // 与其它副本共享的子链表（cJson_DuplicateShared、缓存取出的树）不往下走：那些节点不归这棵树所有
+        if (!recursive || !item->child || share_load(&item->child->shareCount)) continue;
+        for (c = item->child; c; c = c->next) {
+            if (!c->child) continue;
+            if (depth == size && !stack_grow((void **) &stack, &size, sizeof(CJson *), local)) {
+                ok = 0;
+                break;
+            }
+            stack[depth++] = c;
+        }
+        if (!ok) break;
+    }
+    if (stack != local) cJson_free(stack);
+    return ok;
+}
+
+int cJson_GetNumberArray(CJson *item, double *out, int n) {
+    CJson *c;
+    int count = 0;
+    if (!item || (item->type & 255) != CJSON_Array) return -1;
+    if (item->type & cJson_IsPacked) {
+        if (out && n > 0) memcpy(out, item->sValue, (n < item->iValue ? n : item->iValue) * sizeof(double));
+        return item->iValue;
+    }
+    for (c = item->child; c; c = c->next, ++count) {
+        if ((c->type & 255) != CJSON_Number) return -1;
+        if (out && count < n) out[count] = c->dValue;
+    }
+    return count;
+}
+
+int cJson_GetPackedNumber(CJson *array, int index, double *out) {
+    CJson *c;
+    if (!array || (array->type & 255) != CJSON_Array || index < 0) return 0;
+    if (array->type & cJson_IsPacked) {
+        if (index >= array->iValue) return 0;
+        if (out) *out = ((const double *) array->sValue)[index];
+        return 1;
+    }
+    for (c = array->child; c && index > 0; c = c->next) --index;
+    if (!c || (c->type & 255) != CJSON_Number) return 0;
+    if (out) *out = c->dValue;
+    return 1;
+}
+
+char* cJson_GetStringValue(CJson *item) {
+    if (!item || (item->type & 255) != CJSON_String || !materialize(item)) return NULL;
+    return item->sValue;
+}
+
 const char *cJson_GetErrorPtr(void) {
     return ep;
 }
 
+int cJson_GetErrorCode(void) {
+    return ec;
+}
+
 int cJson_GetArraySize(CJson *array) {
     CJson *cj = array->child;
     int count = 0;
+    if (array->type & cJson_IsPacked) return array->iValue;
     while (cj) {
         cj = cj->next;
         ++count;
@@ -265,7 +1039,9 @@ int cJson_GetArraySize(CJson *array) {
 }
 
 CJson* cJson_GetArrayItem(CJson *array, int item) {
-    CJson *cj = array->child;
+    CJson *cj;
+    if (!unpack(array)) return NULL;
+    cj = array->child;
     while (cj && item > 0) {
         cj = cj->next;
         --item;
@@ -275,12 +1051,22 @@ CJson* cJson_GetArrayItem(CJson *array, int item) {
 
 CJson* cJson_GetObjectItem(CJson *object, const char *string) {
     CJson *cj = object->child;
+    if ((object->type & cJson_IsFrozen) && string) return frozen_find(object, string, 0);
     while (cj && cJson_strcasecmp(cj->string, string)) {
         cj = cj->next;
     }
     return cj;
 }
 
+CJson* cJson_GetObjectItemCaseSensitive(CJson *object, const char *string) {
+    CJson *cj = object->child;
+    if ((object->type & cJson_IsFrozen) && string) return frozen_find(object, string, 1);
+    while (cj && (!cj->string || strcmp(cj->string, string))) {
+        cj = cj->next;
+    }
+    return cj;
+}
+
 void cJson_InitHooks(CJson_Hooks *hooks) {
     if (!hooks) { // 重置 hooks
         cJson_malloc = malloc;
@@ -291,57 +1077,174 @@ void cJson_InitHooks(CJson_Hooks *hooks) {
     cJson_free = (hooks->free_fn) ? hooks->free_fn : free;
 }
 
-CJson* cJson_Duplicate(CJson *item, int recurse) {
-    CJson *newItem, *cptr, *nptr = NULL, *newChild;
+void* cJson_Malloc(size_t sz) {
+    return cJson_malloc(sz);
+}
 
-    if (!item) return NULL;
-    
-    newItem = cJson_new_item();
+void cJson_Free(void *ptr) {
+    if (ptr) cJson_free(ptr);
+}
+
+// 复制 item 自身（不含子节点）
+static CJson* duplicate_node(CJson *item) {
+    CJson *newItem = cJson_new_item();
     if (!newItem) return NULL;
 
-    newItem->type = item->type & (~cJson_IsReference);
-    newItem->iValue = item->iValue;
-    newItem->dValue = item->dValue;
-    if (item->sValue) {
-        newItem->sValue = cJson_strdup(item->sValue);
+    newItem->type = item->type & (~(cJson_IsReference | cJson_IsConstString | cJson_IsInlineString | cJson_IsInternedKey
+                                    | cJson_IsRawString | cJson_HasEscapes | cJson_IsFrozen));
+    if (!(item->type & (cJson_IsInlineString | cJson_IsRawString))) {
+        newItem->iValue = item->iValue;
+        newItem->dValue = item->dValue;
+    }
+    if (item->type & cJson_IsPacked) {
+        newItem->sValue = (char *) cJson_malloc(item->iValue * sizeof(double));
+        if (!newItem->sValue) {
+            cJson_Delete(newItem);
+            return NULL;
+        }
+        memcpy(newItem->sValue, item->sValue, item->iValue * sizeof(double));
+    } else if (item->type & cJson_IsFrozen) { // 索引指向原来的成员，副本不冻结
+        newItem->iValue = 0;
+    } else if (item->type & cJson_IsRawString) { // 副本不再引用原文
+        newItem->sValue = raw_to_string(newItem, item->sValue, item->iValue, item->type & cJson_HasEscapes);
+        if (!newItem->sValue) {
+            cJson_Delete(newItem);
+            return NULL;
+        }
+    } else if (item->sValue) {
+        newItem->sValue = cJson_strdup_inline(newItem, item->sValue);
         if (!newItem->sValue) {
             cJson_Delete(newItem);
             return NULL;
         }
     }
     if (item->string) {
-        newItem->string = cJson_strdup(item->string);
+        newItem->string = cJson_strdup_inline(newItem, item->string);
         if (!newItem->string) {
             cJson_Delete(newItem);
             return NULL;
         }
     }
+    return newItem;
+}
 
-    if (!recurse) return newItem;
-    cptr = item->child;
-    while (cptr) {
-        newChild = cJson_Duplicate(cptr, 1);
-        if (!newChild) {
-            cJson_Delete(newItem);
+// 写时复制的浅拷贝：复制 item 自身，子链表与 item 共享
+static CJson* share_node(CJson *item) {
+    CJson *copy;
+    if (item->type & cJson_IsReference) { // 引用节点本来就不持有子节点
+        if (!(copy = create_reference(item))) return NULL;
+        copy->type &= ~(cJson_IsConstString | cJson_IsInternedKey);
+        if (item->string && !(copy->string = cJson_strdup_inline(copy, item->string))) {
+            cJson_Delete(copy);
             return NULL;
         }
-        if (nptr) {
-            nptr->next = newChild;
-            newChild->prev = nptr;
-            nptr = newChild;
-        } else {
-            newItem->child = newChild;
-            nptr = newChild;
+        return copy;
+    }
+    if (!(copy = duplicate_node(item))) return NULL;
+    if (item->child) {
+        share_acquire(item->child);
+        copy->child = item->child;
+    }
+    return copy;
+}
+
+// 修改容器之前调用：紧凑数组先展开；子链表与其它副本共享时，先把这一层复制成自己的
+static int unshare(CJson *item) {
+    CJson *src, *copy, *head = NULL, *prev = NULL, *old = item->child;
+    if (item->type & cJson_IsPacked) return unpack(item);
+    if (!old || (item->type & cJson_IsReference) || !share_load(&old->shareCount)) return 1;
+    thaw(item); // 成员换成副本，索引里的还是共享的节点
+
+    for (src = old; src; src = src->next) {
+        if (!(copy = share_node(src))) {
+            cJson_Delete(head);
+            return 0;
         }
-        cptr = cptr->next;
+        if (prev) suffix_object(prev, copy);
+        else head = copy;
+        prev = copy;
     }
+    item->child = head;
+    if (share_release(old)) cJson_Delete(old);
+    return 1;
+}
+
+// 复制栈的一层：源节点中下一个要复制的兄弟，以及复制品的父节点和最后一个子节点
+typedef struct {
+    CJson *src;
+    CJson *parent;
+    CJson *last;
+} DuplicateFrame;
+
+CJson* cJson_Duplicate(CJson *item, int recurse) {
+    DuplicateFrame local[CJSON_LOCAL_FRAMES], *stack = local;
+    int top = 0, size = CJSON_LOCAL_FRAMES;
+    CJson *newItem, *src, *parent, *last = NULL, *newChild;
+
+    if (!item) return NULL;
+    
+    newItem = duplicate_node(item);
+    if (!newItem) return NULL;
+    if (!recurse) return newItem;
 
+    // 深度优先复制，有子节点时把当前位置压栈再下降
+    src = item->child;
+    parent = newItem;
+    while (1) {
+        for (; src; src = src->next) {
+            newChild = duplicate_node(src);
+            if (!newChild) goto fail;
+            if (last) suffix_object(last, newChild);
+            else parent->child = newChild;
+            last = newChild;
+            if (src->child) {
+                if (top == size && !stack_grow((void **) &stack, &size, sizeof(DuplicateFrame), local)) goto fail;
+                stack[top].src = src->next;
+                stack[top].parent = parent;
+                stack[top].last = last;
+                ++top;
+                parent = newChild;
+                last = NULL;
+                src = src->child;
+                break;
+            }
+        }
+        if (src) continue;
+        if (!top) break;
+        --top;
+        src = stack[top].src;
+        parent = stack[top].parent;
+        last = stack[top].last;
+    }
+    if (stack != local) cJson_free(stack);
     return newItem;
+
+fail:
+    if (stack != local) cJson_free(stack);
+    cJson_Delete(newItem);
+    return NULL;
+}
+
+CJson* cJson_DuplicateShared(CJson *item) {
+    if (!item) return NULL;
+    return share_node(item);
+}
+
+CJson* cJson_GetArrayItemMutable(CJson *array, int item) {
+    if (!unshare(array)) return NULL;
+    return cJson_GetArrayItem(array, item);
+}
+
+CJson* cJson_GetObjectItemMutable(CJson *object, const char *string) {
+    if (!unshare(object)) return NULL;
+    return cJson_GetObjectItem(object, string);
 }
 
 void cJson_AddItemToArray(CJson *array, CJson *item) {
-    CJson *cj = array->child;
-    if (!item) return;
+    CJson *cj;
+    if (!item || !unshare(array)) return;
+    thaw(array);
+    cj = array->child;
     if (!cj) {
         array->child = item;
     } else {
@@ -352,20 +1255,22 @@ void cJson_AddItemToArray(CJson *array, CJson *item) {
 
 void cJson_AddItemToObject(CJson *object, const char *string, CJson *item) {
     if (!item) return;
-    if (item->string) {
+    if (!(item->type & cJson_IsConstString) && item->string && !is_inline(item, item->string)) {
         cJson_free(item->string);
     }
-    item->string = cJson_strdup(string);
+    item->type &= ~(cJson_IsConstString | cJson_IsInternedKey);
+    item->string = NULL;
+    item->string = cJson_strdup_inline(item, string);
     cJson_AddItemToArray(object, item);
 }
 
 void cJson_AddItemToObjectCS(CJson *object, const char *string, CJson *item) {
     if (!item) return;
-    if (!(item->type & cJson_IsConstString) && item->string) {
+    if (!(item->type & cJson_IsConstString) && item->string && !is_inline(item, item->string)) {
         cJson_free(item->string);
     }
     item->string = (char *) string;
-    item->type |= cJson_IsConstString;
+    item->type = (item->type & ~cJson_IsInternedKey) | cJson_IsConstString;
     cJson_AddItemToArray(object, item);
 }
 
@@ -378,7 +1283,10 @@ void cJson_AddItemReferenceToObject(CJson *object, const char *string, CJson *it
 }
 
 CJson* cJson_DetachItemFromArray(CJson *array, int which) {
-    CJson *cj = array->child;
+    CJson *cj;
+    if (!unshare(array)) return NULL;
+    thaw(array);
+    cj = array->child;
     while (cj && which > 0) {
         cj = cj->next;
         --which;
@@ -410,8 +1318,26 @@ void cJson_DeleteItemFromObject(CJson *object, const char *string) {
     cJson_Delete(cJson_DetachItemFromObject(object, string));
 }
 
+CJson* cJson_DetachItemFromObjectCaseSensitive(CJson *object, const char *string) {
+    int which = 0;
+    CJson *cj = object->child;
+    while (cj && (!cj->string || strcmp(cj->string, string))) {
+        cj = cj->next;
+        ++which;
+    }
+    if (cj) return cJson_DetachItemFromArray(object, which);
+    return NULL;
+}
+
+void cJson_DeleteItemFromObjectCaseSensitive(CJson *object, const char *string) {
+    cJson_Delete(cJson_DetachItemFromObjectCaseSensitive(object, string));
+}
+
 void cJson_InsertItemInArray(CJson *array, int which, CJson *newItem) {
-    CJson *cj = array->child;
+    CJson *cj;
+    if (!unshare(array)) return;
+    thaw(array);
+    cj = array->child;
     while (cj && which > 0) {
         cj = cj->next;
         --which;
@@ -431,7 +1357,10 @@ void cJson_InsertItemInArray(CJson *array, int which, CJson *newItem) {
 }
 
 void cJson_ReplaceItemInArray(CJson *array, int which, CJson *newItem) {
-    CJson *cj = array->child;
+    CJson *cj;
+    if (!unshare(array)) return;
+    thaw(array);
+    cj = array->child;
     while (cj && which > 0) {
         cj = cj->next;
         --which;
@@ -449,325 +1378,1658 @@ void cJson_ReplaceItemInArray(CJson *array, int which, CJson *newItem) {
     cJson_Delete(cj);
 }
 
-void cJson_ReplaceItemInObject(CJson *object, const char *string, CJson *newItem) {
+static void replace_item_in_object(CJson *object, const char *string, CJson *newItem, int caseSensitive) {
     int which = 0;
     CJson *cj = object->child;
-    while (cj && cJson_strcasecmp(cj->string, string)) {
+    while (cj && (caseSensitive ? (!cj->string || strcmp(cj->string, string)) : cJson_strcasecmp(cj->string, string))) {
         cj = cj->next;
         ++which;
     }
     if (cj) {
-        newItem->string = cJson_strdup(string);
+        if (!(newItem->type & cJson_IsConstString) && newItem->string && !is_inline(newItem, newItem->string)) {
+            cJson_free(newItem->string);
+        }
+        newItem->type &= ~(cJson_IsConstString | cJson_IsInternedKey);
+        newItem->string = NULL;
+        newItem->string = cJson_strdup_inline(newItem, string);
         cJson_ReplaceItemInArray(object, which, newItem);
     }
 }
 
+void cJson_ReplaceItemInObject(CJson *object, const char *string, CJson *newItem) {
+    replace_item_in_object(object, string, newItem, 0);
+}
+
+void cJson_ReplaceItemInObjectCaseSensitive(CJson *object, const char *string, CJson *newItem) {
+    replace_item_in_object(object, string, newItem, 1);
+}
+
 void cJson_Delete(CJson *cj) {
-    CJson *temp;
+    CJson *next, *tail;
     while (cj) {
-        temp = cj->next;
-        if (!(cj->type & cJson_IsReference) && cj->child) {
-            cJson_Delete(cj->child);
+        next = cj->next;
+        // 不递归：把要释放的子链表接到待删除的链上
+        if (!(cj->type & cJson_IsReference) && cj->child && share_release(cj->child)) {
+            for (tail = cj->child; tail->next; tail = tail->next);
+            tail->next = next;
+            next = cj->child;
         }
-        if (!(cj->type & cJson_IsReference) && cj->sValue) {
+        if (!(cj->type & (cJson_IsReference | cJson_IsRawString)) && cj->sValue && !is_inline(cj, cj->sValue)) {
             cJson_free(cj->sValue);
         }
-        if (!(cj->type & cJson_IsConstString) && cj->string) {
+        if (!(cj->type & cJson_IsConstString) && cj->string && !is_inline(cj, cj->string)) {
             cJson_free(cj->string);
         }
         cJson_free(cj);
-        cj = temp;
+        cj = next;
     }
 }
 
-void cJson_Minify(char *json) {
-    char *into = json;
-    while (*json) {
-        switch (*json) {
-            case ' ':
-            case '\t':
-            case '\r':
-            case '\n': json++; break;
-            case '\"': // string
-                *into++ = *json++;
-                while (*json && *json != '\"') {
-                    if (*json == '\\') *into++ = *json++;
-                    *into++ = *json++;
-                }
-                *into++ = *json++;
-                break;
-            case '/': // comment
-                if (*(json + 1) == '/') { // single line comment
-                    while (*json && *json != '\n') ++json;
-                } else if (*(json + 1) == '*') { // cross line comment
-                    while (*json && !(*json == '*' && *(json + 1) == '/')) ++json;
-                    json += 2;
-                } else *into++ = *json++;
-                break;
-            default: *into++ = *json++; break;
-        }
-    }
-    *into = 0; // null-terminate
-}
+// 压缩时字符串外每个字节的处理：0 原样保留，1 是要去掉的空白，2 是 '"' 或 '/'，要单独处理
+static const unsigned char minifyClass[256] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 0, 0, 1, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    1, 0, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2
+};
+
+// x86 上一次处理 16 个字节：用比较得到 '"'、空白的位掩码，'"' 掩码的前缀异或就是"在字符串内"，
+// 去掉字符串外的空白后用 pshufb 按 8 字节一组压紧。要用到 SSSE3 和 popcnt，运行时检查 CPU
+#if defined(CJSON_SWAR) && (defined(__x86_64__) || defined(__i386__))
+#define CJSON_MINIFY_SIMD 1
+#include <tmmintrin.h>
+
+// 第 m 项是把 8 个字节中 m 的各位为 1 的字节依次移到前面的 pshufb 下标，多余的位置是 0x80（清零）
+static const uint64_t minifyShuffle[256] = {
+    0x8080808080808080ULL, 0x8080808080808000ULL, 0x8080808080808001ULL, 0x8080808080800100ULL,
+    0x8080808080808002ULL, 0x8080808080800200ULL, 0x8080808080800201ULL, 0x8080808080020100ULL,
+    0x8080808080808003ULL, 0x8080808080800300ULL, 0x8080808080800301ULL, 0x8080808080030100ULL,
+    0x8080808080800302ULL, 0x8080808080030200ULL, 0x8080808080030201ULL, 0x8080808003020100ULL,
+    0x8080808080808004ULL, 0x8080808080800400ULL, 0x8080808080800401ULL, 0x8080808080040100ULL,
+    0x8080808080800402ULL, 0x8080808080040200ULL, 0x8080808080040201ULL, 0x8080808004020100ULL,
+    0x8080808080800403ULL, 0x8080808080040300ULL, 0x8080808080040301ULL, 0x8080808004030100ULL,
+    0x8080808080040302ULL, 0x8080808004030200ULL, 0x8080808004030201ULL, 0x8080800403020100ULL,
+    0x8080808080808005ULL, 0x8080808080800500ULL, 0x8080808080800501ULL, 0x8080808080050100ULL,
+    0x8080808080800502ULL, 0x8080808080050200ULL, 0x8080808080050201ULL, 0x8080808005020100ULL,
+    0x8080808080800503ULL, 0x8080808080050300ULL, 0x8080808080050301ULL, 0x8080808005030100ULL,
+    0x8080808080050302ULL, 0x8080808005030200ULL, 0x8080808005030201ULL, 0x8080800503020100ULL,
+    0x8080808080800504ULL, 0x8080808080050400ULL, 0x8080808080050401ULL, 0x8080808005040100ULL,
+    0x8080808080050402ULL, 0x8080808005040200ULL, 0x8080808005040201ULL, 0x8080800504020100ULL,
+    0x8080808080050403ULL, 0x8080808005040300ULL, 0x8080808005040301ULL, 0x8080800504030100ULL,
+    0x8080808005040302ULL, 0x8080800504030200ULL, 0x8080800504030201ULL, 0x8080050403020100ULL,
+    0x8080808080808006ULL, 0x8080808080800600ULL, 0x8080808080800601ULL, 0x8080808080060100ULL,
+    0x8080808080800602ULL, 0x8080808080060200ULL, 0x8080808080060201ULL, 0x8080808006020100ULL,
+    0x8080808080800603ULL, 0x8080808080060300ULL, 0x8080808080060301ULL, 0x8080808006030100ULL,
+    0x8080808080060302ULL, 0x8080808006030200ULL, 0x8080808006030201ULL, 0x8080800603020100ULL,
+    0x8080808080800604ULL, 0x8080808080060400ULL, 0x8080808080060401ULL, 0x8080808006040100ULL,
+    0x8080808080060402ULL, 0x8080808006040200ULL, 0x8080808006040201ULL, 0x8080800604020100ULL,
+    0x8080808080060403ULL, 0x8080808006040300ULL, 0x8080808006040301ULL, 0x8080800604030100ULL,
+    0x8080808006040302ULL, 0x8080800604030200ULL, 0x8080800604030201ULL, 0x8080060403020100ULL,
+    0x8080808080800605ULL, 0x8080808080060500ULL, 0x8080808080060501ULL, 0x8080808006050100ULL,
+    0x8080808080060502ULL, 0x8080808006050200ULL, 0x8080808006050201ULL, 0x8080800605020100ULL,
+    0x8080808080060503ULL, 0x8080808006050300ULL, 0x8080808006050301ULL, 0x8080800605030100ULL,
+    0x8080808006050302ULL, 0x8080800605030200ULL, 0x8080800605030201ULL, 0x8080060503020100ULL,
+    0x8080808080060504ULL, 0x8080808006050400ULL, 0x8080808006050401ULL, 0x8080800605040100ULL,
+    0x8080808006050402ULL, 0x8080800605040200ULL, 0x8080800605040201ULL, 0x8080060504020100ULL,
+    0x8080808006050403ULL, 0x8080800605040300ULL, 0x8080800605040301ULL, 0x8080060504030100ULL,
+    0x8080800605040302ULL, 0x8080060504030200ULL, 0x8080060504030201ULL, 0x8006050403020100ULL,
+    0x8080808080808007ULL, 0x8080808080800700ULL, 0x8080808080800701ULL, 0x8080808080070100ULL,
+    0x8080808080800702ULL, 0x8080808080070200ULL, 0x8080808080070201ULL, 0x8080808007020100ULL,
+    0x8080808080800703ULL, 0x8080808080070300ULL, 0x8080808080070301ULL, 0x8080808007030100ULL,
+    0x8080808080070302ULL, 0x8080808007030200ULL, 0x8080808007030201ULL, 0x8080800703020100ULL,
+    0x8080808080800704ULL, 0x8080808080070400ULL, 0x8080808080070401ULL, 0x8080808007040100ULL,
+    0x8080808080070402ULL, 0x8080808007040200ULL, 0x8080808007040201ULL, 0x8080800704020100ULL,
+    0x8080808080070403ULL, 0x8080808007040300ULL, 0x8080808007040301ULL, 0x8080800704030100ULL,
+    0x8080808007040302ULL, 0x8080800704030200ULL, 0x8080800704030201ULL, 0x8080070403020100ULL,
+    0x8080808080800705ULL, 0x8080808080070500ULL, 0x8080808080070501ULL, 0x8080808007050100ULL,
+    0x8080808080070502ULL, 0x8080808007050200ULL, 0x8080808007050201ULL, 0x8080800705020100ULL,
+    0x8080808080070503ULL, 0x8080808007050300ULL, 0x8080808007050301ULL, 0x8080800705030100ULL,
+    0x8080808007050302ULL, 0x8080800705030200ULL, 0x8080800705030201ULL, 0x8080070503020100ULL,
+    0x8080808080070504ULL, 0x8080808007050400ULL, 0x8080808007050401ULL, 0x8080800705040100ULL,
+    0x8080808007050402ULL, 0x8080800705040200ULL, 0x8080800705040201ULL, 0x8080070504020100ULL,
+    0x8080808007050403ULL, 0x8080800705040300ULL, 0x8080800705040301ULL, 0x8080070504030100ULL,
+    0x8080800705040302ULL, 0x8080070504030200ULL, 0x8080070504030201ULL, 0x8007050403020100ULL,
+    0x8080808080800706ULL, 0x8080808080070600ULL, 0x8080808080070601ULL, 0x8080808007060100ULL,
+    0x8080808080070602ULL, 0x8080808007060200ULL, 0x8080808007060201ULL, 0x8080800706020100ULL,
+    0x8080808080070603ULL, 0x8080808007060300ULL, 0x8080808007060301ULL, 0x8080800706030100ULL,
+    0x8080808007060302ULL, 0x8080800706030200ULL, 0x8080800706030201ULL, 0x8080070603020100ULL,
+    0x8080808080070604ULL, 0x8080808007060400ULL, 0x8080808007060401ULL, 0x8080800706040100ULL,
+    0x8080808007060402ULL, 0x8080800706040200ULL, 0x8080800706040201ULL, 0x8080070604020100ULL,
+    0x8080808007060403ULL, 0x8080800706040300ULL, 0x8080800706040301ULL, 0x8080070604030100ULL,
+    0x8080800706040302ULL, 0x8080070604030200ULL, 0x8080070604030201ULL, 0x8007060403020100ULL,
+    0x8080808080070605ULL, 0x8080808007060500ULL, 0x8080808007060501ULL, 0x8080800706050100ULL,
+    0x8080808007060502ULL, 0x8080800706050200ULL, 0x8080800706050201ULL, 0x8080070605020100ULL,
+    0x8080808007060503ULL, 0x8080800706050300ULL, 0x8080800706050301ULL, 0x8080070605030100ULL,
+    0x8080800706050302ULL, 0x8080070605030200ULL, 0x8080070605030201ULL, 0x8007060503020100ULL,
+    0x8080808007060504ULL, 0x8080800706050400ULL, 0x8080800706050401ULL, 0x8080070605040100ULL,
+    0x8080800706050402ULL, 0x8080070605040200ULL, 0x8080070605040201ULL, 0x8007060504020100ULL,
+    0x8080800706050403ULL, 0x8080070605040300ULL, 0x8080070605040301ULL, 0x8007060504030100ULL,
+    0x8080070605040302ULL, 0x8007060504030200ULL, 0x8007060504030201ULL, 0x0706050403020100ULL
+};
+
+static int minify_has_simd(void) {
+#if defined(__SSSE3__) && defined(__POPCNT__)
+    return 1;
+#else
+    static int cached = -1;
+    if (cached < 0) cached = __builtin_cpu_supports("ssse3") && __builtin_cpu_supports("popcnt");
+    return cached;
+#endif
+}
+
+// 压紧 16 个字节中 keep 的各位为 1 的字节写到 out，返回写出之后的位置
+__attribute__((target("ssse3,popcnt")))
+static inline char* minify_compact(char *out, __m128i v, unsigned keep) {
+    unsigned lo = keep & 0xFF, hi = (keep >> 8) & 0xFF;
+    _mm_storel_epi64((__m128i *) out, _mm_shuffle_epi8(v,
+        _mm_loadl_epi64((const __m128i *) &minifyShuffle[lo])));
+    out += __builtin_popcount(lo);
+    _mm_storel_epi64((__m128i *) out, _mm_shuffle_epi8(v,
+        _mm_add_epi8(_mm_loadl_epi64((const __m128i *) &minifyShuffle[hi]), _mm_set1_epi8(8))));
+    return out + __builtin_popcount(hi);
+}
+
+// 从 in 开始每次处理 32 个字节，遇到有连续 '\\'、字符串外的 '\\' 或 '/' 的块，
+// 或剩下不足 32 个字节时停下，返回停下的位置。*inString 是块边界上是否在字符串内，进出都有效
+__attribute__((target("ssse3,popcnt")))
+static const char* minify_blocks(const char *in, const char *end, char **into, int *inString) {
+    const __m128i quote = _mm_set1_epi8('\"'), backslash = _mm_set1_epi8('\\'), slash = _mm_set1_epi8('/');
+    // 按低 4 位查表：' ' '\t' '\n' '\r' 查到的是自己，其他字节查到的都不等于自己（>= 0x80 的查到 0）
+    const __m128i spaces = _mm_setr_epi8(' ', 0, 0, 0, 0, 0, 0, 0, 0, '\t', '\n', 0, 0, '\r', 0, 0);
+    __m128i v0, v1;
+    unsigned carry = *inString ? ~0u : 0, bs, q, str, ws;
+    char *out = *into;
+
+#define MASK(x) ((unsigned) _mm_movemask_epi8(_mm_cmpeq_epi8(v0, x)) | ((unsigned) _mm_movemask_epi8(_mm_cmpeq_epi8(v1, x)) << 16))
+    while (end - in >= 32) {
+        v0 = _mm_loadu_si128((const __m128i *) in);
+        v1 = _mm_loadu_si128((const __m128i *) (in + 16));
+        bs = MASK(backslash);
+        // 只处理单个的转义：连续的反斜杠、块末尾的反斜杠交给逐字节的循环
+        if (bs & ((bs << 1) | 0x80000000u)) break;
+        q = MASK(quote) & ~(bs << 1);
+        str = q ^ (q << 1);
+        str ^= str << 2;
+        str ^= str << 4;
+        str ^= str << 8;
+        str ^= str << 16;
+        str ^= carry; // 开引号和字符串内容为 1，闭引号为 0
+        if ((bs | MASK(slash)) & ~str) break;
+        ws = (unsigned) _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_shuffle_epi8(spaces, v0), v0))
+            | ((unsigned) _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_shuffle_epi8(spaces, v1), v1)) << 16);
+        ws &= ~str;
+        carry = 0u - (str >> 31);
+        in += 32;
+        // 不管有没有空白都走压紧的路径，避免难以预测的分支。
+        // out 不超过这一块的开头，写出的字节都在已经读过的范围内
+        out = minify_compact(out, v0, ~ws);
+        out = minify_compact(out, v1, ~ws >> 16);
+    }
+#undef MASK
+    *into = out;
+    *inString = carry != 0;
+    return in;
+}
+#endif
+
+// 字符串内第一个 '"' 或 '\\'，一次检查 8 个字节
+static const char* minify_scan_string(const char *ptr, const char *end) {
+#ifdef CJSON_SWAR
+    uint64_t v;
+    while (end - ptr >= 8) {
+        memcpy(&v, ptr, 8);
+        if (HAS_ZERO(v ^ (ONES * '\"')) | HAS_ZERO(v ^ (ONES * '\\'))) break;
+        ptr += 8;
+    }
+#endif
+    while (ptr < end && *ptr != '\"' && *ptr != '\\') ++ptr;
+    return ptr;
+}
+
+// 字符串内容从 in 开始，返回闭引号之后的位置；没有闭合时返回 end
+static const char* minify_string_end(const char *in, const char *end) {
+    while ((in = minify_scan_string(in, end)) < end) {
+        if (*in++ == '\"') break;
+        if (in < end) ++in; // 转义字符后面的一个字节
+    }
+    return in;
+}
+
+// 去掉 [in, in + len) 中字符串外的空白和注释，写到 out（可以等于 in），返回写出的长度。
+// 不要求以 0 结尾；未闭合的字符串/注释到结尾为止。
+// CPU 支持时先按块处理，块处理不了的那一块（转义、注释）交给下面逐字节的循环；
+// 字符串外逐字节查表、无分支地写出（空白写出后不前进），字符串整段复制
+static size_t minify_span(const char *in, size_t len, char *out) {
+    const char *end = in + len, *stop = end, *run;
+    char *into = out;
+    unsigned char ch, cls;
+    int inString = 0;
+#ifdef CJSON_MINIFY_SIMD
+    int simd = minify_has_simd();
+#endif
+
+    while (in < end) {
+#ifdef CJSON_MINIFY_SIMD
+        if (simd) {
+            in = minify_blocks(in, end, &into, &inString);
+            stop = (end - in > 32) ? in + 32 : end;
+        }
+#endif
+        if (inString) { // 块处理停在了字符串中间
+            run = in;
+            in = minify_string_end(in, end);
+            if (into != run) memmove(into, run, in - run);
+            into += in - run;
+            inString = 0;
+        }
+        while (in < stop) {
+            ch = (unsigned char) *in;
+            cls = minifyClass[ch];
+            if (cls != 2) {
+                *into = (char) ch;
+                into += !cls;
+                ++in;
+                continue;
+            }
+            if (ch == '\"') { // string
+                run = in;
+                in = minify_string_end(in + 1, end);
+                if (into != run) memmove(into, run, in - run);
+                into += in - run;
+            } else if (in + 1 < end && in[1] == '/') { // single line comment
+                run = (const char *) memchr(in, '\n', end - in);
+                in = run ? run : end;
+            } else if (in + 1 < end && in[1] == '*') { // cross line comment
+                for (in += 2; in + 1 < end && !(in[0] == '*' && in[1] == '/'); ++in);
+                in = (in + 1 < end) ? in + 2 : end;
+            } else {
+                *into++ = *in++;
+            }
+        }
+    }
+    return into - out;
+}
+
+void cJson_Minify(char *json) {
+    cJson_MinifyLength(json);
+}
+
+size_t cJson_MinifyLength(char *json) {
+    size_t len;
+    if (!json) return 0;
+    len = minify_span(json, strlen(json), json);
+    json[len] = 0; // null-terminate
+    return len;
+}
+
+size_t cJson_MinifyBuffer(char *json, size_t len) {
+    if (!json) return 0;
+    return minify_span(json, len, json);
+}
+
+size_t cJson_MinifyTo(const char *json, size_t len, char *out) {
+    if (!json || !out) return 0;
+    len = minify_span(json, len, out);
+    out[len] = 0;
+    return len;
+}
 
 /* -------------------------------------------------------------------------- */
-/*                                   parsers                                  */
+/*                                  key table                                 */
 /* -------------------------------------------------------------------------- */
 
-// 前置声明
-static const char* parse_value(CJson *item, const char *value);
+// FNV-1a
+static uint64_t hash_bytes(const void *data, size_t len) {
+    const unsigned char *ptr = (const unsigned char *) data;
+    uint64_t h = 0xcbf29ce484222325ULL;
+    while (len--) {
+        h ^= *ptr++;
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
 
-static const char* parse_number(CJson *item, const char *num) {
-    double n = 0, sign = 1, scale = 0;
-    int subScale = 0, signSubScale = 1;
+static char* key_entry_str(KeyEntry *e) {
+    return (char *) (e + 1);
+}
+
+// 查找 [str, str+len)，找不到且 insert 为真时插入一份拷贝；失败或找不到返回 NULL
+static const char* key_table_lookup(CJson_KeyTable *t, const char *str, size_t len, int insert) {
+    uint64_t h = hash_bytes(str, len);
+    size_t i, mask;
+    KeyEntry *e, **newSlots;
+
+    if (insert && (t->count + 1) * 2 > t->capacity) { // 负载因子不超过 1/2
+        size_t newCap = t->capacity ? t->capacity * 2 : 64, j;
+        newSlots = (KeyEntry **) cJson_malloc(newCap * sizeof(KeyEntry *));
+        if (!newSlots) return NULL;
+        memset(newSlots, 0x00, newCap * sizeof(KeyEntry *));
+        for (j = 0; j < t->capacity; j++) {
+            if (!(e = t->slots[j])) continue;
+            for (i = e->hash & (newCap - 1); newSlots[i]; i = (i + 1) & (newCap - 1));
+            newSlots[i] = e;
+        }
+        if (t->slots) cJson_free(t->slots);
+        t->slots = newSlots;
+        t->capacity = newCap;
+    }
+    if (!t->capacity) return NULL;
+
+    mask = t->capacity - 1;
+    for (i = h & mask; (e = t->slots[i]); i = (i + 1) & mask) {
+        if (e->hash == h && e->len == len && !memcmp(key_entry_str(e), str, len)) return key_entry_str(e);
+    }
+    if (!insert) return NULL;
+
+    e = (KeyEntry *) cJson_malloc(sizeof(KeyEntry) + len + 1);
+    if (!e) return NULL;
+    e->hash = h;
+    e->len = len;
+    memcpy(key_entry_str(e), str, len);
+    key_entry_str(e)[len] = 0;
+    t->slots[i] = e;
+    t->count++;
+    return key_entry_str(e);
+}
+
+CJson_KeyTable* cJson_CreateKeyTable(void) {
+    CJson_KeyTable *t = (CJson_KeyTable *) cJson_malloc(sizeof(CJson_KeyTable));
+    if (t) memset(t, 0x00, sizeof(CJson_KeyTable));
+    return t;
+}
+
+void cJson_DeleteKeyTable(CJson_KeyTable *table) {
+    size_t i;
+    if (!table) return;
+    for (i = 0; i < table->capacity; i++) {
+        if (table->slots[i]) cJson_free(table->slots[i]);
+    }
+    if (table->slots) cJson_free(table->slots);
+    cJson_free(table);
+}
+
+const char* cJson_InternKey(CJson_KeyTable *table, const char *string) {
+    if (!table || !string) return NULL;
+    return key_table_lookup(table, string, strlen(string), 1);
+}
+
+CJson* cJson_GetObjectItemInterned(CJson *object, CJson_KeyTable *table, const char *string) {
+    const char *key;
+    CJson *cj;
+    if (!table || !string) return cJson_GetObjectItem(object, string);
+    key = key_table_lookup(table, string, strlen(string), 0);
+    for (cj = object->child; cj; cj = cj->next) {
+        if (cj->string == key && key) return cj;
+        // 不是从驻留表来的键名只能逐字节比较
+        if (!(cj->type & cJson_IsInternedKey) && cj->string && !strcmp(cj->string, string)) return cj;
+    }
+    return NULL;
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                  workspace                                 */
+/* -------------------------------------------------------------------------- */
+
+// 从工作区划出 n 字节（按 8 字节对齐）。当前块放不下时换到后面留下的块，不够大才分配新块
+static void* workspace_alloc(CJson_Workspace *ws, size_t n) {
+    WorkspaceBlock *b = ws->cur, *next;
+    size_t size;
+    void *ptr;
+
+    n = (n + 7) & ~(size_t) 7;
+    if (!b || ws->used + n > b->size) {
+        next = b ? b->next : ws->blocks;
+        if (!next || next->size < n) {
+            size = b ? b->size * 2 : CJSON_WORKSPACE_BLOCK;
+            if (size < n) size = n;
+            if (!(next = (WorkspaceBlock *) cJson_malloc(sizeof(WorkspaceBlock) + size))) return NULL;
+            next->size = size;
+            next->next = b ? b->next : ws->blocks;
+            if (b) b->next = next;
+            else ws->blocks = next;
+        }
+        ws->cur = next;
+        ws->used = 0;
+    }
+    ptr = (char *) (ws->cur + 1) + ws->used;
+    ws->used += n;
+    return ptr;
+}
+
+CJson_Workspace* cJson_CreateWorkspace(void) {
+    CJson_Workspace *ws = (CJson_Workspace *) cJson_malloc(sizeof(CJson_Workspace));
+    if (ws) memset(ws, 0x00, sizeof(CJson_Workspace));
+    return ws;
+}
+
+void cJson_DeleteWorkspace(CJson_Workspace *ws) {
+    WorkspaceBlock *b, *next;
+    if (!ws) return;
+    for (b = ws->blocks; b; b = next) {
+        next = b->next;
+        cJson_free(b);
+    }
+    if (ws->parseStack) cJson_free(ws->parseStack);
+    if (ws->printStack) cJson_free(ws->printStack);
+    if (ws->out) cJson_free(ws->out);
+    cJson_free(ws);
+}
+
+void cJson_ResetWorkspace(CJson_Workspace *ws) {
+    if (!ws) return;
+    ws->cur = NULL;
+    ws->used = 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                   compare                                  */
+/* -------------------------------------------------------------------------- */
+
+static uint64_t mix64(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+static uint64_t hash_number(double d) {
+    uint64_t bits;
+    if (d == 0) d = 0; // -0 与 0 相等
+    memcpy(&bits, &d, sizeof(double));
+    return mix64(mix64((uint64_t) CJSON_Number + 1) ^ bits);
+}
+
+// 标量、空数组/空对象和紧凑数组的哈希；acc 为容器已经合并的子节点哈希。
+// 紧凑数组与展开后的普通数组哈希相同
+// 字符串值的哈希，sValue 为 NULL 时为 0。原文片段按解码后的内容计算
+static uint64_t hash_string(CJson *item) {
+    const char *str;
+    char *tmp;
+    size_t len;
+    uint64_t h;
+    if (!item->sValue || !(str = string_view(item, &len, &tmp))) return 0;
+    h = hash_bytes(str, len);
+    if (tmp) cJson_free(tmp);
+    return h;
+}
+
+static uint64_t hash_node(CJson *item, uint64_t acc) {
+    uint64_t h = mix64((uint64_t) (item->type & 255) + 1);
+    int i;
+    switch (item->type & 255) {
+        case CJSON_Number:
+            return hash_number(item->dValue);
+        case CJSON_String:
+            return mix64(h ^ hash_string(item));
+        case CJSON_Array:
+        case CJSON_Object:
+            if (item->type & cJson_IsPacked) {
+                for (i = 0; i < item->iValue; i++) acc = mix64(acc ^ hash_number(((const double *) item->sValue)[i]));
+            }
+            return mix64(h + acc);
+        default:
+            return h;
+    }
+}
 
-    if (*num == '-') sign = -1, ++num;
+uint64_t cJson_Hash(CJson *item) {
+    HashFrame local[CJSON_LOCAL_FRAMES], *stack = local, *f;
+    int top = 0, size = CJSON_LOCAL_FRAMES, type;
+    const char *key;
+    uint64_t h;
+
+    if (!item) return 0;
+    while (1) {
+        type = item->type & 255;
+        if ((type == CJSON_Array || type == CJSON_Object) && item->child) {
+            if (top == size && !stack_grow((void **) &stack, &size, sizeof(HashFrame), local)) {
+                if (stack != local) cJson_free(stack);
+                return 0;
+            }
+            f = &stack[top++];
+            f->container = item;
+            f->acc = 0;
+            item = item->child;
+            continue;
+        }
+        h = hash_node(item, 0);
+
+        // 子节点的哈希合并到父节点：数组按顺序依次混合，对象把各成员（键名 + 值）的哈希相加，与顺序无关
+        while (top) {
+            f = &stack[top - 1];
+            if ((f->container->type & 255) == CJSON_Array) {
+                f->acc = mix64(f->acc ^ h);
+            } else {
+                key = item->string ? item->string : "";
+                f->acc += mix64(hash_bytes(key, strlen(key)) ^ h);
+            }
+            if (item->next) break;
+            item = f->container;
+            h = hash_node(item, f->acc);
+            --top;
+        }
+        if (!top) break;
+        item = item->next;
+    }
+    if (stack != local) cJson_free(stack);
+    return h;
+}
+
+// 不比较哈希的深度比较。待比较的节点对压在显式栈上；对象成员先看同一位置上的键名，
+// 不同时再按键名查找
+// 对象 b 中与 a 的成员 x 对应的成员。重复的键名按出现的先后一一对应
+static CJson* matching_member(CJson *a, CJson *x, CJson *b) {
+    const char *key = x->string ? x->string : "";
+    CJson *c;
+    int k = 0;
+    for (c = a->child; c != x; c = c->next) {
+        if (!strcmp(c->string ? c->string : "", key)) k++;
+    }
+    for (c = b->child; c; c = c->next) {
+        if (!strcmp(c->string ? c->string : "", key) && !k--) return c;
+    }
+    return NULL;
+}
+
+// 两个数组中至少有一个是紧凑数组
+static int equals_packed(CJson *a, CJson *b) {
+    const double *values;
+    CJson *x;
+    int i;
+    if (!(a->type & cJson_IsPacked)) {
+        x = a;
+        a = b;
+        b = x;
+    }
+    values = (const double *) a->sValue;
+    if (b->type & cJson_IsPacked) {
+        if (a->iValue != b->iValue) return 0;
+        for (i = 0; i < a->iValue; i++) {
+            if (values[i] != ((const double *) b->sValue)[i]) return 0;
+        }
+        return 1;
+    }
+    for (i = 0, x = b->child; x; x = x->next, i++) {
+        if (i >= a->iValue || (x->type & 255) != CJSON_Number || x->dValue != values[i]) return 0;
+    }
+    return i == a->iValue;
+}
+
+static int equals_string(CJson *a, CJson *b) {
+    const char *x, *y;
+    char *tx, *ty;
+    size_t lx, ly;
+    int ok;
+    if (!((a->type | b->type) & cJson_IsRawString)) return !strcmp(a->sValue ? a->sValue : "", b->sValue ? b->sValue : "");
+    x = string_view(a, &lx, &tx);
+    y = string_view(b, &ly, &ty);
+    ok = x && y && lx == ly && !memcmp(x, y, lx);
+    if (tx) cJson_free(tx);
+    if (ty) cJson_free(ty);
+    return ok;
+}
+
+static int equals_deep(CJson *a, CJson *b) {
+    CJson *local[CJSON_LOCAL_FRAMES * 2], **stack = local, *x, *y;
+    int top = 0, size = CJSON_LOCAL_FRAMES, ok = 1, aligned;
+
+    stack[top++] = a;
+    stack[top++] = b;
+    while (top && ok) {
+        b = stack[--top];
+        a = stack[--top];
+        if ((a->type & 255) != (b->type & 255)) {
+            ok = 0;
+            break;
+        }
+        switch (a->type & 255) {
+            case CJSON_Number:
+                ok = a->dValue == b->dValue;
+                break;
+            case CJSON_String:
+                ok = equals_string(a, b);
+                break;
+            case CJSON_Array:
+            case CJSON_Object:
+                if ((a->type | b->type) & cJson_IsPacked) {
+                    ok = equals_packed(a, b);
+                    break;
+                }
+                for (x = a->child, y = b->child; x && y; x = x->next, y = y->next);
+                if (x || y) { // 子节点个数不同
+                    ok = 0;
+                    break;
+                }
+                aligned = 1;
+                for (x = a->child, y = b->child; x && ok; x = x->next, y = y ? y->next : NULL) {
+                    // 对象成员的顺序通常相同，先看同一位置；键名序列一旦错开就按键名找
+                    if ((a->type & 255) == CJSON_Object && (!aligned || strcmp(y->string ? y->string : "", x->string ? x->string : ""))) {
+                        aligned = 0;
+                        if (!(y = matching_member(a, x, b))) {
+                            ok = 0;
+                            break;
+                        }
+                    }
+                    if (top + 2 > size * 2 && !stack_grow((void **) &stack, &size, 2 * sizeof(CJson *), local)) {
+                        ok = 0;
+                        break;
+                    }
+                    stack[top++] = x;
+                    stack[top++] = y;
+                }
+                break;
+        }
+    }
+    if (stack != local) cJson_free(stack);
+    return ok;
+}
+
+int cJson_Equals(CJson *a, CJson *b) {
+    int type;
+    if (!a || !b) return a == b;
+    if (a == b) return 1;
+    type = a->type & 255;
+    if (type != (b->type & 255)) return 0;
+    // 容器先比较哈希，不同时不需要逐个比较子节点
+    if ((type == CJSON_Array || type == CJSON_Object) && cJson_Hash(a) != cJson_Hash(b)) return 0;
+    return equals_deep(a, b);
+}
+
+int cJson_EqualsNoHash(CJson *a, CJson *b) {
+    if (!a || !b) return a == b;
+    if (a == b) return 1;
+    return equals_deep(a, b);
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                   parsers                                  */
+/* -------------------------------------------------------------------------- */
+
+// 有效数字不超过 15 位、十进制指数不超过 22 时，整数部分和 10 的幂都是精确的，
+// 一次乘除就得到正确舍入的结果；其余情况把这段原文交给 strtod
+static const char* parse_double(const char *num, double *out) {
+    const char *start = num;
+    char local[64], *buf, *ptr, point;
+    uint64_t mant = 0;
+    int digits = 0, scale = 0, exp = 0, expSign = 1, neg = 0;
+    size_t len;
+    double n;
+
+    if (*num == '-') neg = 1, ++num;
     if (*num == '0') ++num;
-    if (*num >= '1' && *num <= '9') {
-        do {
-            n = (n * 10.0) + (*num++ - '0');
-        } while (*num >= '0' && *num <= '9');
+    for (; *num >= '0' && *num <= '9'; ++num) {
+        if (digits < 19) mant = mant * 10 + (*num - '0');
+        if (mant) ++digits;
     }
     if (*num == '.' && *(num + 1) >= '0' && *(num + 1) <= '9') {
-        ++num;
-        do {
-            n = (n * 10.0) + (*num++ - '0');
-            --scale;
-        } while (*num >= '0' && *num <= '9');
+        for (++num; *num >= '0' && *num <= '9'; ++num) {
+            if (digits < 19) mant = mant * 10 + (*num - '0'), --scale;
+            if (mant) ++digits;
+        }
     }
     if (*num == 'e' || *num == 'E') {
         ++num;
         if (*num == '+') ++num;
-        else if (*num == '-') signSubScale = -1, ++num;
-        while (*num >= '0' && *num <= '9') {
-            subScale = (subScale * 10) + (*num++ - '0');
+        else if (*num == '-') expSign = -1, ++num;
+        for (; *num >= '0' && *num <= '9'; ++num) {
+            if (exp < 100000) exp = exp * 10 + (*num - '0'); // 再大也只是 0 或无穷大
         }
     }
 
-    n = sign * n * pow(10.0, (scale + subScale * signSubScale));
-    item->dValue = n;
-    item->iValue = (int) n;
-    item->type = CJSON_Number;
+    scale += expSign * exp;
+    if (!mant) {
+        n = 0;
+    } else if (digits <= 15 && scale >= -22 && scale <= 22) {
+        n = scale < 0 ? (double) mant / pow10Table[-scale] : (double) mant * pow10Table[scale];
+    } else {
+        len = num - start;
+        if (!(buf = len < sizeof(local) ? local : (char *) cJson_malloc(len + 1))) return NULL;
+        memcpy(buf, start, len);
+        buf[len] = 0;
+        point = localeconv()->decimal_point[0]; // strtod 按当前 locale 识别小数点
+        if (point != '.' && (ptr = strchr(buf, '.'))) *ptr = point;
+        n = fabs(strtod(buf, NULL));
+        if (buf != local) cJson_free(buf);
+    }
+
+    *out = neg ? -n : n;
     return num;
 }
 
-static unsigned parse_hex4(const char *str) {
-    unsigned h = 0;
-
-    if (*str >= '0' && *str <= '9') h += (*str) - '0';
-    else if (*str >= 'A' && *str <= 'F') h += 10 + (*str) - 'A';
-    else if (*str >= 'a' && *str <= 'f') h += 10 + (*str) - 'a';
-    else return 0;
+static const char* parse_number(CJson *item, const char *num) {
+    double d;
+    if (!(num = parse_double(num, &d))) return NULL;
+    item->dValue = d;
+    item->iValue = double_to_int(d);
+    item->type = CJSON_Number;
+    return num;
+}
 
-    h <<= 4;
-    ++str;
-    if (*str >= '0' && *str <= '9') h += (*str) - '0';
-    else if (*str >= 'A' && *str <= 'F') h += 10 + (*str) - 'A';
-    else if (*str >= 'a' && *str <= 'f') h += 10 + (*str) - 'a';
-    else return 0;
+// 4 个十六进制字符的值，含无效字符时返回 -1
+static long parse_hex4(const char *str) {
+    const unsigned char *s = (const unsigned char *) str;
+    int a, b, c, d;
+    if ((a = hexValue[s[0]]) < 0 || (b = hexValue[s[1]]) < 0 ||
+        (c = hexValue[s[2]]) < 0 || (d = hexValue[s[3]]) < 0) return -1;
+    return (a << 12) | (b << 8) | (c << 4) | d;
+}
 
-    h <<= 4;
-    ++str;
-    if (*str >= '0' && *str <= '9') h += (*str) - '0';
-    else if (*str >= 'A' && *str <= 'F') h += 10 + (*str) - 'A';
-    else if (*str >= 'a' && *str <= 'f') h += 10 + (*str) - 'a';
-    else return 0;
+static int utf8_encode(unsigned long uc, char *out) {
+    int len = 4;
+    if (uc < 0x80) len = 1;
+    else if (uc < 0x800) len = 2;
+    else if (uc < 0x10000) len = 3;
+    out += len;
+    switch (len) {
+        case 4: *--out = (char) ((uc | 0x80) & 0xBF); uc >>= 6; // fall through
+        case 3: *--out = (char) ((uc | 0x80) & 0xBF); uc >>= 6; // fall through
+        case 2: *--out = (char) ((uc | 0x80) & 0xBF); uc >>= 6; // fall through
+        case 1: *--out = (char) (uc | firstByteMark[len]);
+    }
+    return len;
+}
 
-    h <<= 4;
-    ++str;
-    if (*str >= '0' && *str <= '9') h += (*str) - '0';
-    else if (*str >= 'A' && *str <= 'F') h += 10 + (*str) - 'A';
-    else if (*str >= 'a' && *str <= 'f') h += 10 + (*str) - 'a';
-    else return 0;
+// 解析一个转义序列，ptr 指向反斜杠之后的字符，返回转义序列之后的位置；
+// *uc 为解码出的码点，-1 表示不输出。
+// 严格模式下未知的转义字符、不完整的 \u、孤立的代理项和 \u0000 返回 NULL，ep 指向反斜杠；
+// 宽松模式沿用原来的做法：丢弃无效的 \u 转义，未知的转义字符原样输出
+static const char* parse_escape(const char *ptr, long *uc, int strict) {
+    long lo;
+    int n;
+
+    switch (*ptr) {
+        case 'b': *uc = '\b'; return ptr + 1;
+        case 'f': *uc = '\f'; return ptr + 1;
+        case 'n': *uc = '\n'; return ptr + 1;
+        case 'r': *uc = '\r'; return ptr + 1;
+        case 't': *uc = '\t'; return ptr + 1;
+        case '\"': case '\\': case '/': *uc = *ptr; return ptr + 1;
+        case 'u': break;
+        case 0: // 反斜杠之后字符串就结束了
+            *uc = -1;
+            if (strict) break;
+            return ptr;
+        default:
+            *uc = (unsigned char) *ptr;
+            if (strict) break;
+            return ptr + 1;
+    }
+    if (*ptr != 'u') {
+        ep = ptr - 1;
+        return NULL;
+    }
 
-    return h;
+    if ((*uc = parse_hex4(ptr + 1)) < 0) {
+        if (strict) {
+            ep = ptr - 1;
+            return NULL;
+        }
+        for (n = 1; n <= 4 && hexValue[(unsigned char) ptr[n]] >= 0; n++);
+        return ptr + n;
+    }
+    if ((*uc >= 0xDC00 && *uc <= 0xDFFF) || *uc == 0) {
+        if (strict) {
+            ep = ptr - 1;
+            return NULL;
+        }
+        *uc = -1;
+        return ptr + 5;
+    }
+    if (*uc >= 0xD800 && *uc <= 0xDBFF) { // 高代理项后面必须紧跟低代理项
+        if (ptr[5] == '\\' && ptr[6] == 'u' && (lo = parse_hex4(ptr + 7)) >= 0xDC00 && lo <= 0xDFFF) {
+            *uc = 0x10000 + (((*uc & 0x3FF) << 10) | (lo & 0x3FF));
+            return ptr + 11;
+        }
+        if (strict) {
+            ep = ptr - 1;
+            return NULL;
+        }
+        *uc = -1;
+    }
+    return ptr + 5;
 }
 
-static const char* parse_string(CJson *item, const char *str) {
-    const char *ptr = str + 1;
-    char *ptr2;
-    char *out;
-    int len = 0;
-    unsigned uc, uc2;
+// 找到 str 处字符串结尾的引号（宽松模式下没有引号时停在结尾的 0 上），不解码。
+// *len 为解码后长度的上界，*escapes 为转义序列与（宽松模式下）未转义的控制字符的个数，为 0 时原文本身
+// 就是合法的字符串内容；严格模式下同时校验 UTF-8 和转义序列
+static const char* scan_string(const char *str, int strict, int *len, int *escapes) {
+    const char *ptr = str + 1, *run;
+    long uc;
 
+    *len = *escapes = 0;
     if (*str != '\"') {
         ep = str;
         return 0;
     }
-    while (*ptr != '\"' && *ptr && ++len) {
-        if (*ptr++ == '\\') ++ptr;
-    }
-    out = (char *) cJson_malloc(len + 1);
-    if (!out) return 0;
-
-    ptr = str + 1;
-    ptr2 = out;
-    while (*ptr != '\"' && *ptr) {
-        if (*ptr != '\\') *ptr2++ = *ptr++;
-        else {
-            ++ptr;
-            switch (*ptr) {
-                case 'b': *ptr2++ = '\b'; break;
-                case 'f': *ptr2++ = '\f'; break;
-                case 'n': *ptr2++ = '\n'; break;
-                case 'r': *ptr2++ = '\r'; break;
-                case 't': *ptr2++ = '\t'; break;
-                case 'u': // transcode utf-16 to utf-8
-                    uc = parse_hex4(ptr + 1);
-                    ptr += 4;
-                    if ((uc >= 0xDC00 && uc <= 0xDFFF) || uc == 0) break;
-                    if (uc >= 0xD800 && uc <= 0xDBFF) {
-                        if (ptr[1] != '\\' || ptr[2] != 'u') break;
-                        uc2 = parse_hex4(ptr + 3);
-                        ptr += 6;
-                        if (uc2 < 0xDC00 || uc2 > 0xDFFF) break;
-                        uc = 0x10000 + (((uc & 0x3FF) << 10) | (uc2 & 0x3FF));
-                    }
-                    len = 4;
-                    if (uc < 0x80) len = 1;
-                    else if (uc < 0x800) len = 2;
-                    else if (uc < 0x10000) len = 3;
-                    ptr2 += len;
-                    switch (len) {
-                        case 4: *--ptr2 = ((uc | 0x80) & 0xBF); uc >>= 6;
-                        case 3: *--ptr2 = ((uc | 0x80) & 0xBF); uc >>= 6;
-                        case 2: *--ptr2 = ((uc | 0x80) & 0xBF); uc >>= 6;
-                        case 1: *--ptr2 = (uc | firstByteMark[len]);
-                    }
-                    ptr2 += len;
-                    break;
-                default: *ptr2++ = *ptr; break;
+    while (1) {
+        run = ptr;
+        ptr = scan_plain(ptr, strict);
+        *len += ptr - run;
+        if (*ptr == '\"') return ptr;
+        if (*ptr == '\\') {
+            ++*escapes;
+            if (!(ptr = parse_escape(ptr + 1, &uc, strict))) return 0;
+            *len += 4; // 一个转义序列最多解码成 4 字节
+        } else if (!*ptr) { // 没有结尾的引号
+            if (strict) {
+                ep = ptr;
+                return 0;
+            }
+            return ptr;
+        } else if ((unsigned char) *ptr < 0x20) {
+            if (strict) {
+                ep = ptr;
+                return 0;
             }
             ++ptr;
+            ++*len;
+            ++*escapes;
+        } else { // >= 0x80，只有严格模式会停在这里
+            if (!(ptr = check_utf8(run = ptr))) {
+                ep = run;
+                return 0;
+            }
+            *len += ptr - run;
         }
     }
+}
+
+// 解析时的分配：有工作区时从工作区划出，否则用 cJson_malloc。工作区的内存不单独释放。
+// 超过 maxAllocBytes 时失败，ep 留给 parse_run 填上
+static void* parse_alloc(ParseContext *c, size_t n) {
+    if (n > c->byteQuota) {
+        ec = CJSON_ERROR_BYTES;
+        return NULL;
+    }
+    c->byteQuota -= n;
+    return c->ws ? workspace_alloc(c->ws, n) : cJson_malloc(n);
+}
+
+static void parse_free(ParseContext *c, void *ptr) {
+    if (!c->ws) cJson_free(ptr);
+}
+
+static CJson* parse_new_item(ParseContext *c) {
+    CJson *nd;
+    if (!c->nodeQuota || c->byteQuota < sizeof(CJson)) {
+        ec = c->nodeQuota ? CJSON_ERROR_BYTES : CJSON_ERROR_NODES;
+        return NULL;
+    }
+    --c->nodeQuota;
+    c->byteQuota -= sizeof(CJson);
+    if (!c->ws) return cJson_new_item();
+    nd = (CJson *) workspace_alloc(c->ws, sizeof(CJson));
+    if (nd) {
+        memset(nd, 0x00, sizeof(CJson));
+        STAT_ADD(nodes, 1);
+    }
+    return nd;
+}
+
+// 把 scan_string 检查过的 [ptr, end) 解码到 out，两个转义序列之间的原文整段复制。
+// 加上结尾的 0，返回解码后的长度
+static int unescape(const char *ptr, const char *end, int escapes, char *out) {
+    const char *run;
+    char *ptr2 = out;
+    long uc;
+
+    while (ptr < end) {
+        run = escapes ? (const char *) memchr(ptr, '\\', end - ptr) : NULL;
+        if (!run) run = end;
+        memcpy(ptr2, ptr, run - ptr);
+        ptr2 += run - ptr;
+        if (run == end) break;
+        ptr = parse_escape(run + 1, &uc, 0);
+        if (uc >= 0) ptr2 += utf8_encode(uc, ptr2);
+    }
     *ptr2 = 0;
-    if (*ptr == '\"') ++ptr;
-    item->sValue = out;
+    return (int) (ptr2 - out);
+}
+
+// 第二遍：把 scan_string 检查过的字符串解码成 item 的值，end 是它找到的结尾
+static const char* store_string(CJson *item, const char *str, const char *end, int len, int escapes, ParseContext *c) {
+    char *out;
     item->type = CJSON_String;
-    return ptr;
+    out = inline_alloc(item, len + 1);
+    if (!out) {
+        if (!(out = (char *) parse_alloc(c, len + 1))) {
+            if (ec) ep = str;
+            return 0;
+        }
+        STAT_ADD(stringBytes, len + 1);
+    }
+    unescape(str + 1, end, escapes, out);
+    item->sValue = out;
+    return (*end == '\"') ? end + 1 : end;
+}
+
+// 引号之间的原文超过 maxStringLength 时失败
+static int string_too_long(ParseContext *c, const char *str, const char *end) {
+    if ((size_t) (end - str - 1) <= c->maxString) return 0;
+    ep = str;
+    ec = CJSON_ERROR_STRING;
+    return 1;
+}
+
+static const char* parse_string(CJson *item, const char *str, ParseContext *c) {
+    const char *end;
+    int len, escapes;
+    if (!(end = scan_string(str, c->strictStrings, &len, &escapes)) || string_too_long(c, str, end)) return 0;
+    return store_string(item, str, end, len, escapes, c);
 }
 
-static const char* parse_array(CJson *item, const char *value) {
+// 字符串值只记下原文片段（cJson_IsRawString），不解码也不复制。宽松模式下原文含有转义或控制字符时
+// 不一定能原样输出，仍然立即解码
+static const char* parse_raw_string(CJson *item, const char *str, ParseContext *c) {
+    const char *end;
+    int len, escapes;
+
+    if (!(end = scan_string(str, c->strictStrings, &len, &escapes)) || string_too_long(c, str, end)) return 0;
+    if (escapes && !c->strictStrings) return store_string(item, str, end, len, escapes, c);
+    item->type = CJSON_String | cJson_IsRawString | (escapes ? cJson_HasEscapes : 0);
+    item->sValue = (char *) (str + 1);
+    item->iValue = (int) (end - str - 1);
+    return (*end == '\"') ? end + 1 : end;
+}
+
+// 把 parse_string 解析到临时节点 key 上的键名移到 item 上；
+// 键名要等值解析完、知道 item 的类型之后才能决定能否内联
+static int adopt_key(CJson *item, CJson *key, ParseContext *c) {
+    char *buf;
+    size_t len;
+    if (!is_inline(key, key->sValue)) {
+        item->string = key->sValue;
+        return 1;
+    }
+    len = strlen(key->sValue) + 1;
+    buf = inline_alloc(item, len);
+    if (!buf) {
+        if (!(buf = (char *) parse_alloc(c, len))) return 0;
+        STAT_ADD(stringBytes, len);
+    }
+    memcpy(buf, key->sValue, len);
+    item->string = buf;
+    return 1;
+}
+
+// 键名换成驻留表中的共享拷贝。不含转义的键名直接用原文查表，不需要先解码
+static const char* parse_interned_key(ParseContext *c, const char *value, const char **key) {
+    const char *ptr = value + 1;
+    CJson tmp;
+
+    if (*value == '\"') {
+        ptr = scan_plain(ptr, c->strictStrings);
+        if (*ptr == '\"') {
+            if (string_too_long(c, value, ptr)) return NULL;
+            if (!(*key = key_table_lookup(c->keys, value + 1, ptr - value - 1, 1))) return NULL;
+            return ptr + 1;
+        }
+    }
+    memset(&tmp, 0x00, sizeof(CJson));
+    if (!(ptr = parse_string(&tmp, value, c))) return NULL;
+    *key = key_table_lookup(c->keys, tmp.sValue, strlen(tmp.sValue), 1);
+    if (!is_inline(&tmp, tmp.sValue)) parse_free(c, tmp.sValue);
+    return *key ? ptr : NULL;
+}
+
+// 值解析完之后把等待中的键名放到 c->cur 上
+static int adopt_pending_key(ParseContext *c) {
+    if (c->internedKey) {
+        c->cur->string = (char *) c->internedKey;
+        c->cur->type |= cJson_IsConstString | cJson_IsInternedKey;
+        c->internedKey = NULL;
+        return 1;
+    }
+    if (!c->hasKey) return 1;
+    c->hasKey = 0;
+    return adopt_key(c->cur, &c->key, c);
+}
+
+static void drop_pending_key(ParseContext *c) {
+    if (c->hasKey && !is_inline(&c->key, c->key.sValue)) parse_free(c, c->key.sValue);
+    c->hasKey = 0;
+    c->internedKey = NULL;
+}
+
+// 在栈顶的容器末尾追加一个子节点作为 c->cur；对象还要先解析键名和冒号
+// 数组下标：不带前导 0 的十进制数，否则返回 -1
+static long proj_index(const char *key, int len) {
+    long index = 0;
+    int i;
+    if (!len || len > 9 || (key[0] == '0' && len > 1)) return -1;
+    for (i = 0; i < len; ++i) {
+        if (key[i] < '0' || key[i] > '9') return -1;
+        index = index * 10 + (key[i] - '0');
+    }
+    return index;
+}
+
+// parent 下键为 key 的子节点，没有就加一个。节点数组可能搬家，只能用下标
+static int proj_child(Projection *p, int parent, const char *key, int len) {
+    ProjNode *n;
+    int i;
+    for (i = p->nodes[parent].child; i >= 0; i = p->nodes[i].next) {
+        if (p->nodes[i].len == len && !memcmp(p->nodes[i].key, key, len)) return i;
+    }
+    if (p->count == p->capacity && !stack_grow((void **) &p->nodes, &p->capacity, sizeof(ProjNode), NULL)) return -1;
+    n = &p->nodes[p->count];
+    n->key = key;
+    n->len = len;
+    n->index = proj_index(key, len);
+    n->wildcard = len == 1 && *key == '*';
+    n->all = 0;
+    n->child = -1;
+    n->next = p->nodes[parent].child;
+    p->nodes[parent].child = p->count;
+    return p->count++;
+}
+
+// 把 src 的子树合并到 dst 下
+static int proj_merge(Projection *p, int dst, int src) {
+    int i, d;
+    if (p->nodes[src].all) p->nodes[dst].all = 1;
+    for (i = p->nodes[src].child; i >= 0; i = p->nodes[i].next) {
+        if ((d = proj_child(p, dst, p->nodes[i].key, p->nodes[i].len)) < 0 || !proj_merge(p, d, i)) return 0;
+    }
+    return 1;
+}
+
+// "*" 的子树合并到每个具体的兄弟节点下，这样解析时每个成员只需要走一个节点。
+// 递归的深度不超过路径的段数
+static int proj_expand(Projection *p, int n) {
+    int i, any = -1;
+    for (i = p->nodes[n].child; i >= 0; i = p->nodes[i].next) {
+        if (p->nodes[i].wildcard) any = i;
+    }
+    for (i = p->nodes[n].child; i >= 0; i = p->nodes[i].next) {
+        if (any >= 0 && i != any && !proj_merge(p, i, any)) return 0;
+        if (!proj_expand(p, i)) return 0;
+    }
+    return 1;
+}
+
+static void proj_free(Projection *p) {
+    if (p->nodes) cJson_free(p->nodes);
+    if (p->keys) cJson_free(p->keys);
+}
+
+// 把 JSON Pointer 形式的路径（"/a/0/b"，~0、~1 转义，"*" 匹配任何成员）建成前缀树。
+// 路径格式不对或者比 maxDepth 还深时失败
+static int proj_compile(Projection *p, const char **paths, int count, int maxDepth) {
+    size_t total = 1;
+    const char *ptr;
+    char *out;
+    int i, n, depth;
+
+    memset(p, 0x00, sizeof(Projection));
+    for (i = 0; i < count; ++i) total += strlen(paths[i]);
+    p->capacity = 16;
+    p->nodes = (ProjNode *) cJson_malloc(p->capacity * sizeof(ProjNode));
+    p->keys = (char *) cJson_malloc(total);
+    if (!p->nodes || !p->keys) return 0;
+    memset(p->nodes, 0x00, sizeof(ProjNode));
+    p->nodes[0].index = -1;
+    p->nodes[0].child = p->nodes[0].next = -1;
+    p->count = 1;
+
+    out = p->keys;
+    for (i = 0; i < count; ++i) {
+        ptr = paths[i];
+        n = depth = 0;
+        while (*ptr) {
+            const char *key = out;
+            if (*ptr++ != '/' || ++depth > maxDepth) return 0;
+            while (*ptr && *ptr != '/') {
+                if (*ptr == '~') {
+                    if (ptr[1] != '0' && ptr[1] != '1') return 0;
+                    *out++ = (ptr[1] == '0') ? '~' : '/';
+                    ptr += 2;
+                } else {
+                    *out++ = *ptr++;
+                }
+            }
+            if ((n = proj_child(p, n, key, (int) (out - key))) < 0) return 0;
+        }
+        p->nodes[n].all = 1;
+    }
+    return proj_expand(p, 0);
+}
+
+// n 的子节点中与键名（key 非空时）或数组下标匹配的那个。具体的键优先，其次是 "*"
+static const ProjNode* proj_match(const ProjNode *nodes, const ProjNode *n, const char *key, int len, long index) {
+    const ProjNode *m, *any = NULL;
+    int i;
+    for (i = n->child; i >= 0; i = m->next) {
+        m = &nodes[i];
+        if (m->wildcard) any = m;
+        else if (key ? (m->len == len && !memcmp(m->key, key, len)) : m->index == index) return m;
+    }
+    return any;
+}
+
+static const char* skip_value(const char *value, ParseContext *c);
+
+// 投影解析：跳过不在路径上的成员，值只做语法检查，不建立节点。选中了一个成员时 *found 为 1，返回它的开头
+// （对象成员是键名），c->curProj 为它在前缀树中的节点（整个保留时为 NULL）；剩下的成员都跳过了时
+// *found 为 0，返回最后一个成员之后的位置
+static const char* select_member(ParseContext *c, ParseFrame *f, const char *value, int *found) {
+    int object = (f->container->type & 255) == CJSON_Object, len, escapes;
+    const char *member, *end;
+    const ProjNode *m;
+    char *key;
+
+    while (1) {
+        member = value;
+        if (object) {
+            if (!(end = scan_string(value, c->strictStrings, &len, &escapes))) return NULL;
+            if (!escapes) {
+                m = proj_match(c->projNodes, f->proj, value + 1, (int) (end - value - 1), -1);
+            } else { // 键名含转义，解码之后再比较。与节点上的键名一样到第一个 0 为止
+                if (!(key = (char *) cJson_malloc(len + 1))) return NULL;
+                unescape(value + 1, end, escapes, key);
+                m = proj_match(c->projNodes, f->proj, key, (int) strlen(key), -1);
+                cJson_free(key);
+            }
+            value = *end ? skip(end + 1) : end;
+            if (*value != ':') {
+                ep = value;
+                return NULL;
+            }
+            value = skip(value + 1);
+        } else {
+            m = proj_match(c->projNodes, f->proj, NULL, 0, f->index);
+        }
+        if (++f->index > c->maxMembers) {
+            ep = member;
+            ec = CJSON_ERROR_MEMBERS;
+            return NULL;
+        }
+        // 路径的中间一段只能走进数组/对象
+        if (m && (m->all || valueClass[(unsigned char) *value] >= VALUE_ARRAY)) {
+            c->curProj = m->all ? NULL : m;
+            *found = 1;
+            return member;
+        }
+        if (!(value = skip_value(value, c))) return NULL;
+        value = skip(value);
+        if (*value != ',') break;
+        value = skip(value + 1);
+    }
+    *found = 0;
+    return value;
+}
+
+static const char* parse_member(ParseContext *c, const char *value) {
+    ParseFrame *f = &c->stack[c->depth - 1];
     CJson *child;
-    if (*value != '[') {
+    int found;
+    if (f->proj) {
+        if (!(value = select_member(c, f, value, &found))) return NULL;
+        if (!found) { // 没有更多的成员，由 parse_run 关闭容器
+            c->cur = NULL;
+            return value;
+        }
+    } else if (++f->index > c->maxMembers) {
         ep = value;
+        ec = CJSON_ERROR_MEMBERS;
         return NULL;
     }
-    item->type = CJSON_Array;
-    value = skip(value + 1);
-    if (*value == ']') return value + 1; // empty array
+    if (!(child = parse_new_item(c))) {
+        if (ec) ep = value;
+        return NULL;
+    }
+    if (f->last) suffix_object(f->last, child);
+    else f->container->child = child;
+    f->last = c->cur = child;
+    if ((f->container->type & 255) != CJSON_Object) return value;
 
-    item->child = child = cJson_new_item();
-    if (!item->child) return NULL;
-    value = skip(parse_value(child, skip(value)));
+    if (c->keys) {
+        value = parse_interned_key(c, value, &c->internedKey);
+    } else {
+        memset(&c->key, 0x00, sizeof(CJson));
+        value = parse_string(&c->key, value, c);
+        c->hasKey = value != NULL;
+    }
+    value = skip(value);
     if (!value) return NULL;
+    if (*value != ':') { // 失败
+        ep = value;
+        return NULL;
+    }
+    return value + 1;
+}
 
-    while (*value == ',') {
-        CJson *newItem;
-        if (!(newItem = cJson_new_item())) return NULL;
-        child->next = newItem;
-        newItem->prev = child;
-        child = newItem;
-        value = skip(parse_value(child,skip(value + 1)));
-        if (!value) return NULL;
+static const char* parse_scalar(CJson *item, const char *value, ParseContext *c) {
+    switch (valueClass[(unsigned char) *value]) {
+        case VALUE_STRING:
+            return c->rawStrings ? parse_raw_string(item, value, c) : parse_string(item, value, c);
+        case VALUE_NUMBER:
+            return parse_number(item, value);
+        case VALUE_TRUE:
+            if (!match4(value, "true")) break;
+            item->type = CJSON_True;
+            return value + 4;
+        case VALUE_FALSE:
+            if (!match4(value + 1, "alse")) break;
+            item->type = CJSON_False;
+            return value + 5;
+        case VALUE_NULL:
+            if (!match4(value, "null")) break;
+            item->type = CJSON_NULL;
+            return value + 4;
     }
-    if (*value == ']') return value + 1;
+    // 失败
     ep = value;
     return NULL;
 }
 
-static const char* parse_object(CJson *item, const char *value) {
-    CJson *child;
-    if (*value != '{') {
-        ep = value;
+// value 在 '[' 之后的第一个元素上，整个数组都是数字时解析成紧凑数组，返回 ']' 之后的位置。
+// 先扫一遍到 ']'，只含数字、空白和 ',' 时按 ',' 的个数一次分配好。
+// 遇到别的元素或语法错误返回 NULL，item 不变，由调用者按普通数组重新解析（错误也在那时报告）
+static const char* parse_packed(ParseContext *c, CJson *item, const char *value) {
+    const char *ptr;
+    double *values;
+    int count = 1, i;
+
+    for (ptr = value; *ptr != ']'; ++ptr) {
+        if (*ptr == ',') ++count;
+        else if (!((*ptr >= '0' && *ptr <= '9') || *ptr == '-' || *ptr == '+' || *ptr == '.'
+                   || *ptr == 'e' || *ptr == 'E' || (*ptr && (unsigned char) *ptr <= 32))) return NULL;
+    }
+    // 超过上限的交给逐个元素的解析，由它报告准确的位置
+    if (count > c->maxMembers || count * sizeof(double) > c->byteQuota) return NULL;
+    if (!(values = (double *) cJson_malloc(count * sizeof(double)))) return NULL;
+    for (i = 0; i < count; i++) {
+        if (*value != '-' && (*value < '0' || *value > '9')) break;
+        if (!(value = parse_double(value, &values[i]))) break;
+        value = skip(value);
+        if (*value != (i + 1 < count ? ',' : ']')) break;
+        value = skip(value + 1);
+    }
+    if (i < count) {
+        cJson_free(values);
         return NULL;
     }
-    item->type = CJSON_Object;
-    value = skip(value + 1);
-    if (*value == '}') return value + 1; // empty object
+    c->byteQuota -= count * sizeof(double);
+    item->sValue = (char *) values;
+    item->iValue = count;
+    item->type |= cJson_IsPacked;
+    return value;
+}
 
-    item->child = child = cJson_new_item();
-    if (!item->child) return NULL;
-    value = skip(parse_value(child, skip(value)));
+// 把 c->ptr 处的一个完整的值解析到 c->cur，成功后 c->ptr 移到值之后。
+// 数组/对象不递归，而是压到 c->stack 上，嵌套层数受 c->maxDepth 限制。
+// 成功返回 CJSON_PARSE_DONE，失败返回 CJSON_PARSE_FAILED；预算用完时在下一个值之前停下，
+// c->ptr 指向那里，返回 CJSON_PARSE_PENDING，之后用同一个 c 再调用就接着解析
+static int parse_run(ParseContext *c) {
+    const char *value = c->ptr, *packed, *at = value;
+    ParseFrame *f;
+    char close;
+
+    while (1) {
+        if (c->budget) {
+            if ((c->maxBytes && (size_t) (value - c->stepStart) >= c->maxBytes) || !c->nodesLeft) {
+                c->ptr = value;
+                return CJSON_PARSE_PENDING;
+            }
+            --c->nodesLeft;
+        }
+        at = value = skip(value);
+        if (valueClass[(unsigned char) *value] >= VALUE_ARRAY) {
+            close = (*value == '[') ? ']' : '}';
+            c->cur->type = (*value == '[') ? CJSON_Array : CJSON_Object;
+            if (!adopt_pending_key(c)) goto fail;
+            value = skip(value + 1);
+            if (close == ']' && c->packNumbers && !c->curProj && c->depth < c->maxDepth
+                && valueClass[(unsigned char) *value] == VALUE_NUMBER && (packed = parse_packed(c, c->cur, value))) {
+                value = packed;
+            } else if (*value != close) { // 非空：压栈，解析第一个成员
+                if (c->depth >= c->maxDepth) {
+                    ep = value;
+                    ec = CJSON_ERROR_DEPTH;
+                    goto fail;
+                }
+                if (c->depth == c->stackSize && !stack_grow((void **) &c->stack, &c->stackSize, sizeof(ParseFrame), c->local)) goto fail;
+                f = &c->stack[c->depth++];
+                STAT_DEPTH(c->depth);
+                f->container = c->cur;
+                f->last = NULL;
+                f->proj = c->curProj;
+                f->index = 0;
+                if (!(value = parse_member(c, value))) goto fail;
+                if (!c->cur) goto closing; // 投影解析跳过了所有成员
+                continue;
+            } else {
+                ++value;
+            }
+        } else {
+            if (!(value = parse_scalar(c->cur, value, c)) || !adopt_pending_key(c)) goto fail;
+        }
+
+        // 一个值结束：遇到 ',' 继续解析下一个成员，否则依次关闭已经结束的容器
+    closing:
+        while (c->depth > 0) {
+            f = &c->stack[c->depth - 1];
+            value = skip(value);
+            if (*value == ',') break;
+            close = ((f->container->type & 255) == CJSON_Array) ? ']' : '}';
+            if (*value != close) {
+                ep = value;
+                goto fail;
+            }
+            ++value;
+            --c->depth;
+        }
+        if (!c->depth) break;
+        if (!(value = parse_member(c, skip(value + 1)))) goto fail;
+        if (!c->cur) goto closing;
+    }
+    c->ptr = value;
+    return CJSON_PARSE_DONE;
+
+fail:
+    if (ec && !ep) ep = at; // 值解析完之后放键名时超出了上限
+    drop_pending_key(c);
+    return CJSON_PARSE_FAILED;
+}
+
+static void parse_context_init(ParseContext *c, const CJson_ParseOptions *opts) {
+    memset(c, 0x00, sizeof(ParseContext));
+    c->stack = c->local;
+    c->stackSize = CJSON_LOCAL_FRAMES;
+    c->maxDepth = CJSON_NESTING_LIMIT;
+    c->nodeQuota = c->byteQuota = c->maxString = (size_t) -1;
+    c->maxMembers = LONG_MAX;
+    if (!opts) return;
+    if (opts->maxNodes) c->nodeQuota = opts->maxNodes;
+    if (opts->maxAllocBytes) c->byteQuota = opts->maxAllocBytes;
+    if (opts->maxStringLength) c->maxString = opts->maxStringLength;
+    if (opts->maxMembers > 0) c->maxMembers = opts->maxMembers;
+    c->keys = opts->keys;
+    c->strictStrings = opts->strictStrings;
+    c->packNumbers = opts->packNumbers;
+    c->rawStrings = opts->rawStrings;
+    if (opts->maxDepth > 0) c->maxDepth = opts->maxDepth;
+}
+
+// 在工作区里解析：节点和字符串从 ws 分配，解析栈借用 ws 上次留下的（所有权暂时转到 c 上）。
+// 紧凑数组要单独释放缓冲区、原文片段解码时要分配，这里都不用
+static void parse_context_use(ParseContext *c, CJson_Workspace *ws) {
+    c->ws = ws;
+    c->packNumbers = 0;
+    c->rawStrings = 0;
+    if (!ws->parseStack) return;
+    c->stack = ws->parseStack;
+    c->stackSize = ws->parseStackSize;
+    ws->parseStack = NULL;
+}
+
+// 堆上的解析栈释放掉，或者交还给工作区
+static void parse_context_free(ParseContext *c) {
+    if (c->stack != c->local) {
+        if (c->ws) {
+            c->ws->parseStack = c->stack;
+            c->ws->parseStackSize = c->stackSize;
+        } else {
+            cJson_free(c->stack);
+        }
+    }
+    c->stack = c->local;
+    c->stackSize = CJSON_LOCAL_FRAMES;
+}
+
+static const char* parse_value(CJson *item, const char *value, ParseContext *c) {
     if (!value) return NULL;
-    child->string = child->sValue;
-    child->sValue = NULL;
-    if (*value != ':') { // 失败
+    c->cur = item;
+    c->ptr = value;
+    c->depth = 0;
+    return parse_run(c) == CJSON_PARSE_DONE ? c->ptr : NULL;
+}
+
+// 对象的键名和冒号，只检查不解码
+static const char* skip_key(const char *value, ParseContext *c) {
+    int len, escapes;
+    if (!(value = scan_string(value, c->strictStrings, &len, &escapes))) return NULL;
+    if (*value) value = skip(value + 1);
+    if (*value != ':') {
         ep = value;
         return NULL;
     }
-    value = skip(parse_value(child, skip(value + 1)));
-    if (!value) return NULL;
+    return skip(value + 1);
+}
 
-    while (*value == ',') {
-        CJson *newItem;
-        if (!(newItem = cJson_new_item())) return NULL;
-        child->next = newItem;
-        newItem->prev = child;
-        child = newItem;
-        value = skip(parse_string(child, skip(value + 1)));
-        if (!value) return NULL;
-        child->string = child->sValue;
-        child->sValue = NULL;
-        if (*value != ':') { // 失败
-            ep = value;
-            return NULL;
+// 数字的结尾，接受的写法与 parse_double 相同，但不求值
+static const char* skip_number(const char *num) {
+    if (*num == '-') ++num;
+    if (*num == '0') ++num;
+    while (*num >= '0' && *num <= '9') ++num;
+    if (*num == '.' && *(num + 1) >= '0' && *(num + 1) <= '9') {
+        for (num += 2; *num >= '0' && *num <= '9'; ++num);
+    }
+    if (*num == 'e' || *num == 'E') {
+        ++num;
+        if (*num == '+' || *num == '-') ++num;
+        while (*num >= '0' && *num <= '9') ++num;
+    }
+    return num;
+}
+
+// 跳过 value 处的一个完整的值，语法检查与 parse_run 相同，但不建立节点、不分配内存。
+// 嵌套的数组/对象只在栈上记下各层的结束符
+static const char* skip_value(const char *value, ParseContext *c) {
+    char local[CJSON_LOCAL_FRAMES * 4], *stack = local, close;
+    int depth = 0, size = sizeof(local), len, escapes;
+    CJson tmp;
+
+    while (1) {
+        value = skip(value);
+        if (valueClass[(unsigned char) *value] >= VALUE_ARRAY) {
+            close = (*value == '[') ? ']' : '}';
+            value = skip(value + 1);
+            if (*value != close) {
+                if (depth >= c->maxDepth) {
+                    ep = value;
+                    ec = CJSON_ERROR_DEPTH;
+                    goto fail;
+                }
+                if (depth == size && !stack_grow((void **) &stack, &size, 1, local)) goto fail;
+                stack[depth++] = close;
+                if (close == '}' && !(value = skip_key(value, c))) goto fail;
+                continue;
+            }
+            ++value;
+        } else if (*value == '\"') {
+            if (!(value = scan_string(value, c->strictStrings, &len, &escapes))) goto fail;
+            if (*value) ++value;
+        } else if (valueClass[(unsigned char) *value] == VALUE_NUMBER) {
+            value = skip_number(value);
+        } else if (!(value = parse_scalar(&tmp, value, c))) {
+            goto fail;
         }
-        if (!value) return NULL;
+
+        while (depth > 0) {
+            value = skip(value);
+            if (*value == ',') break;
+            if (*value != stack[depth - 1]) {
+                ep = value;
+                goto fail;
+            }
+            ++value;
+            --depth;
+        }
+        if (!depth) break;
+        value = skip(value + 1);
+        if (stack[depth - 1] == '}' && !(value = skip_key(value, c))) goto fail;
     }
-    if (*value == '}') return value + 1;
-    ep = value;
+    if (stack != local) cJson_free(stack);
+    return value;
+
+fail:
+    if (stack != local) cJson_free(stack);
     return NULL;
 }
 
-static const char* parse_value(CJson *item, const char *value) {
-    if (!value) return 0;
-    if (!strncmp(value, "false", 5)) {
-        item->type = CJSON_False;
-        return value + 5;
+// 解析失败时补上错误码：超出上限的地方已经设好了，否则 ep 非空是语法错误，为空是内存不足
+static void parse_failed(void) {
+    if (!ec) ec = ep ? CJSON_ERROR_SYNTAX : CJSON_ERROR_MEMORY;
+}
+
+// ws 非空时树建在工作区里，失败时把工作区退回到解析之前的位置。proj 非空时只保留前缀树上的路径
+static CJson* parse_ex(const char *value, const char **returnParseEnd, const CJson_ParseOptions *opts, CJson_Workspace *ws, const ProjNode *proj) {
+    const char *end = 0;
+    int requireNullTerminated = opts ? opts->requireNullTerminated : 0;
+    ParseContext c;
+    WorkspaceBlock *mark = ws ? ws->cur : NULL;
+    size_t markUsed = ws ? ws->used : 0;
+    CJson *cj;
+
+    ep = 0;
+    ec = CJSON_ERROR_NONE;
+    if (!value) return NULL;
+    parse_context_init(&c, opts);
+    if (ws) parse_context_use(&c, ws);
+    if (proj) {
+        c.projNodes = proj;
+        c.curProj = proj->all ? NULL : proj;
     }
-    if (!strncmp(value, "true", 4)) {
-        item->type = CJSON_True;
-        return value + 4;
+    if ((cj = parse_new_item(&c))) {
+        end = parse_value(cj, skip(value), &c);
+    } else if (ec) {
+        ep = value;
     }
-    if (!strncmp(value, "null", 4)) {
-        item->type = CJSON_NULL;
-        return value + 4;
+    parse_context_free(&c);
+    if (end && requireNullTerminated) {
+        end = skip(end);
+        if (*end) {
+            ep = end;
+            end = NULL;
+        }
     }
-    if (*value == '\"') return parse_string(item, value);
-    if (*value == '-' || (*value >= '0' && *value <= '9')) return parse_number(item, value);
-    if (*value == '[') return parse_array(item, value);
-    if (*value == '{') return parse_object(item, value);
-    // 失败
-    ep = value;
-    return NULL;
+    if (!end) { // 失败
+        parse_failed();
+        if (!ws) {
+            cJson_Delete(cj);
+        } else {
+            ws->cur = mark;
+            ws->used = markUsed;
+        }
+        return NULL;
+    }
+    if (returnParseEnd) *returnParseEnd = end;
+    return cj;
+}
+
+CJson* cJson_ParseEx(const char *value, const char **returnParseEnd, const CJson_ParseOptions *opts) {
+    CJson *cj;
+    STATS_BEGIN();
+    cj = parse_ex(value, returnParseEnd, opts, NULL, NULL);
+    STATS_END(0, opts ? opts->stats : NULL);
+    return cj;
+}
+
+CJson* cJson_ParseProjected(const char *value, const char **paths, int count, const char **returnParseEnd, const CJson_ParseOptions *opts) {
+    Projection proj;
+    CJson *cj = NULL;
+    STATS_BEGIN();
+    ep = 0;
+    ec = CJSON_ERROR_NONE;
+    if (proj_compile(&proj, paths, count, (opts && opts->maxDepth > 0) ? opts->maxDepth : CJSON_NESTING_LIMIT)) {
+        cj = parse_ex(value, returnParseEnd, opts, NULL, proj.nodes);
+    }
+    proj_free(&proj);
+    STATS_END(0, opts ? opts->stats : NULL);
+    return cj;
 }
 
-CJson* cJson_ParseWithOpts(const char *value, const char **returnParseEnd,  int requireNullTerminated) {
-    const char *end = 0;
-    CJson *cj = cJson_new_item();
+CJson* cJson_ParseWorkspace(CJson_Workspace *ws, const char *value, const char **returnParseEnd, const CJson_ParseOptions *opts) {
+    CJson *cj;
+    if (!ws) return NULL;
+    STATS_BEGIN();
+    cj = parse_ex(value, returnParseEnd, opts, ws, NULL);
+    STATS_END(0, opts ? opts->stats : NULL);
+    return cj;
+}
+
+CJson_Parser* cJson_CreateParser(const char *value, const CJson_ParseOptions *opts) {
+    CJson_Parser *parser;
+    if (!value) return NULL;
+    if (!(parser = (CJson_Parser *) cJson_malloc(sizeof(CJson_Parser)))) return NULL;
+    memset(parser, 0x00, sizeof(CJson_Parser));
+    parse_context_init(&parser->c, opts);
     ep = 0;
-    if (!cj) return NULL; // 失败
-    
-    end = parse_value(cj, skip(value));
-    if (!end) { // 失败
-        cJson_Delete(cj);
+    ec = CJSON_ERROR_NONE;
+    if (!(parser->root = parse_new_item(&parser->c))) { // 失败
+        if (ec) ep = value;
+        parse_failed();
+        cJson_free(parser);
         return NULL;
     }
+    parser->c.budget = 1;
+    parser->c.cur = parser->root;
+    parser->c.ptr = skip(value);
+    parser->requireNullTerminated = opts ? opts->requireNullTerminated : 0;
+    parser->state = CJSON_PARSE_PENDING;
+    return parser;
+}
 
-    if (requireNullTerminated) {
-        end = skip(end);
+int cJson_ParseStep(CJson_Parser *parser, size_t maxBytes, size_t maxNodes) {
+    ParseContext *c;
+    const char *end;
+    if (!parser) return CJSON_PARSE_FAILED;
+    if (parser->state != CJSON_PARSE_PENDING) return parser->state;
+
+    c = &parser->c;
+    c->stepStart = c->ptr;
+    c->maxBytes = maxBytes;
+    c->nodesLeft = maxNodes ? maxNodes : (size_t) -1;
+    ep = 0;
+    ec = CJSON_ERROR_NONE;
+    parser->state = parse_run(c);
+    if (parser->state == CJSON_PARSE_PENDING) return CJSON_PARSE_PENDING;
+
+    parse_context_free(c);
+    if (parser->state == CJSON_PARSE_DONE && parser->requireNullTerminated) {
+        c->ptr = end = skip(c->ptr);
         if (*end) {
-            cJson_Delete(cj);
             ep = end;
-            return NULL;
+            parser->state = CJSON_PARSE_FAILED;
         }
     }
-    if (returnParseEnd) *returnParseEnd = end;
+    if (parser->state == CJSON_PARSE_FAILED) {
+        parse_failed();
+        cJson_Delete(parser->root);
+        parser->root = NULL;
+    }
+    return parser->state;
+}
+
+CJson* cJson_ParserResult(CJson_Parser *parser, const char **returnParseEnd) {
+    CJson *cj;
+    if (!parser || parser->state != CJSON_PARSE_DONE) return NULL;
+    cj = parser->root;
+    parser->root = NULL;
+    if (cj && returnParseEnd) *returnParseEnd = parser->c.ptr;
     return cj;
 }
 
+void cJson_DeleteParser(CJson_Parser *parser) {
+    if (!parser) return;
+    if (parser->state == CJSON_PARSE_PENDING) {
+        drop_pending_key(&parser->c);
+        parse_context_free(&parser->c);
+    }
+    cJson_Delete(parser->root);
+    cJson_free(parser);
+}
+
+CJson* cJson_ParseWithOpts(const char *value, const char **returnParseEnd, int requireNullTerminated) {
+    CJson_ParseOptions opts;
+    memset(&opts, 0x00, sizeof(CJson_ParseOptions));
+    opts.requireNullTerminated = requireNullTerminated;
+    return cJson_ParseEx(value, returnParseEnd, &opts);
+}
+
 CJson* cJson_Parse(const char *value) {
     return cJson_ParseWithOpts(value, 0, 0);
 }
@@ -776,368 +3038,908 @@ CJson* cJson_Parse(const char *value) {
 /*                                   printer                                  */
 /* -------------------------------------------------------------------------- */
 
-static char* print_number(CJson *item, PrintBuffer *p) {
+// 码点 s 的第一个 UTF-16 码元；不完整的序列按单个字节算
+static unsigned utf16_first_unit(const unsigned char *s) {
+    unsigned long cp;
+    if (s[0] < 0xC0 || !s[1]) return s[0];
+    if (s[0] < 0xE0) return ((s[0] & 0x1F) << 6) | (s[1] & 0x3F);
+    if (!s[2]) return s[0];
+    if (s[0] < 0xF0) return ((s[0] & 0x0F) << 12) | ((s[1] & 0x3F) << 6) | (s[2] & 0x3F);
+    if (!s[3]) return s[0];
+    cp = ((unsigned long) (s[0] & 0x07) << 18) | ((s[1] & 0x3F) << 12) | ((s[2] & 0x3F) << 6) | (s[3] & 0x3F);
+    return cp >= 0x10000 ? 0xD800 + (unsigned) ((cp - 0x10000) >> 10) : (unsigned) cp;
+}
+
+// RFC 8785 按 UTF-16 码元比较键名。UTF-8 的字节序就是码点顺序，只有 U+E000..U+FFFF 与增补平面的字符
+// 和 UTF-16 的顺序不同，所以只在第一个不同的码点处按 UTF-16 比较
+static int compare_keys(const void *x, const void *y) {
+    const char *a = (*(CJson * const *) x)->string, *b = (*(CJson * const *) y)->string;
+    const unsigned char *s, *t;
+    unsigned ua, ub;
+
+    s = (const unsigned char *) (a ? a : "");
+    t = (const unsigned char *) (b ? b : "");
+    while (*s && *s == *t) s++, t++;
+    if (*s == *t) return 0;
+    while (s > (const unsigned char *) (a ? a : "") && (*s & 0xC0) == 0x80) s--, t--; // 退回码点的起始字节
+    ua = utf16_first_unit(s);
+    ub = utf16_first_unit(t);
+    if (ua != ub) return ua < ub ? -1 : 1;
+    return *s < *t ? -1 : 1;
+}
+
+// 对象成员按 compare 稳定排序（归并），相等的键名保持原来的先后；结果用 cJson_free 释放
+static CJson** sort_members(CJson *object, int *count, int (*compare)(const void *, const void *)) {
+    CJson **sorted, **tmp, **src, **dst, *c;
+    int n = 0, width, lo, mid, hi, i, j, k;
+
+    for (c = object->child; c; c = c->next) n++;
+    if (!(sorted = (CJson **) cJson_malloc(2 * n * sizeof(CJson *)))) return NULL;
+    for (n = 0, c = object->child; c; c = c->next) sorted[n++] = c;
+    src = sorted;
+    dst = tmp = sorted + n;
+    for (width = 1; width < n; width *= 2) {
+        for (lo = 0; lo < n; lo += 2 * width) {
+            mid = lo + width < n ? lo + width : n;
+            hi = lo + 2 * width < n ? lo + 2 * width : n;
+            for (i = lo, j = mid, k = lo; k < hi; k++) {
+                if (i < mid && (j >= hi || compare(&src[i], &src[j]) <= 0)) dst[k] = src[i++];
+                else dst[k] = src[j++];
+            }
+        }
+        dst = src;
+        src = (src == sorted) ? tmp : sorted;
+    }
+    if (src != sorted) memcpy(sorted, src, n * sizeof(CJson *));
+    *count = n;
+    return sorted;
+}
+
+// ECMAScript Number.prototype.toString 的格式（RFC 8785）：能往返的最短有效数字，
+// 1e-7 <= |d| < 1e21 时不用指数。NaN 和无穷大没有 JSON 表示，写成 null
+static char* print_number_canonical(double d, PrintBuffer *p) {
+    char buf[32], digits[20], *str, *out;
+    const char *ptr;
+    int prec, k = 0, n, i;
+
+    if (!(out = str = ensure(p, 32))) return NULL;
+    if (d != d || d - d != 0) {
+        strcpy(str, "null");
+        return out;
+    }
+    if (d == 0) {
+        strcpy(str, "0");
+        return out;
+    }
+    for (prec = 1; prec < 17; prec++) {
+        sprintf(buf, "%.*e", prec - 1, d);
+        if (strtod(buf, NULL) == d) break;
+    }
+    sprintf(buf, "%.*e", prec - 1, d);
+    if (d < 0) *str++ = '-';
+    for (ptr = buf; *ptr != 'e'; ptr++) {
+        if (*ptr >= '0' && *ptr <= '9') digits[k++] = *ptr;
+    }
+    while (k > 1 && digits[k - 1] == '0') --k;
+    n = atoi(ptr + 1) + 1; // 小数点在第 n 位数字之后
+
+    if (k <= n && n <= 21) {
+        for (i = 0; i < n; i++) *str++ = i < k ? digits[i] : '0';
+    } else if (0 < n && n <= 21) {
+        for (i = 0; i < k; i++) {
+            if (i == n) *str++ = '.';
+            *str++ = digits[i];
+        }
+    } else if (-6 < n && n <= 0) {
+        *str++ = '0';
+        *str++ = '.';
+        for (i = n; i < 0; i++) *str++ = '0';
+        for (i = 0; i < k; i++) *str++ = digits[i];
+    } else {
+        *str++ = digits[0];
+        if (k > 1) *str++ = '.';
+        for (i = 1; i < k; i++) *str++ = digits[i];
+        str += sprintf(str, "e%c%d", n - 1 < 0 ? '-' : '+', n - 1 < 0 ? 1 - n : n - 1);
+    }
+    *str = 0;
+    return out;
+}
+
+// iValue 是 d 取整（cJson_SetNumberHelper 的规则）的结果
+static char* print_double(double d, int iValue, PrintBuffer *p) {
     char *str = NULL;
-    double d = item->dValue;
+    if (p->canonical) return print_number_canonical(d, p);
     if (d == 0) {
-        if (p) str = ensure(p, 2);
-        else str = (char *) cJson_malloc(2);
+        str = ensure(p, 2);
         if (str) strcpy(str, "0");
-    } else if (fabs(((double) item->iValue) - d) <= DBL_EPSILON && d <= INT_MAX && d >= INT_MIN) {
-        if (p) str = ensure(p, 21);
-        else str = (char *) cJson_malloc(21);
-        if (str) sprintf(str, "%d", item->iValue);
+    } else if ((double) iValue == d) { // 与 DBL_EPSILON 比较会把 1e-99 这样的小数写成 0
+        str = ensure(p, 21);
+        if (str) sprintf(str, "%d", iValue);
+    } else if (d != d || d - d != 0) { // NaN 和无穷大没有 JSON 表示
+        str = ensure(p, 5);
+        if (str) strcpy(str, "null");
     } else {
-        if (p) str = ensure(p, 64);
-        else str = (char *) cJson_malloc(64);
+        str = ensure(p, 64);
         if (str) {
-            if (fabs(floor(d) - d) <= DBL_EPSILON && fabs(d) < 1.0e60) sprintf(str, "%.0f", d);
-            else if (fabs(d) < 1.0e-6 || fabs(d) > 1.0e9) sprintf(str, "%e", d);
-            else sprintf(str, "%f", d);
+            // 15 位有效数字不能往返时用 17 位，保证重新解析得到同一个 double
+            if (floor(d) == d && fabs(d) < 1.0e60) sprintf(str, "%.0f", d);
+            else if (sprintf(str, "%1.15g", d) > 0 && strtod(str, NULL) != d) sprintf(str, "%1.17g", d);
         }
     }
     return str;
 }
 
-static char* print_string_ptr(const char *str, PrintBuffer *p) {
-    const char *ptr;
-    char *ptr2, *out;
-    int len = 0, flag = 0;
-    unsigned char token;
+static char* print_number(CJson *item, PrintBuffer *p) {
+    return print_double(item->dValue, item->iValue, p);
+}
 
-    for (ptr = str; *ptr; ptr++) {
-        flag |= ((*ptr > 0 && *ptr < 32) || (*ptr == '\"') || (*ptr == '\\')) ? 1 : 0;
-    }
-    if (!flag) {
-        len = ptr - str;
-        if (p) out = ensure(p, len + 3);
-        else out = (char *) cJson_malloc(len + 3);
+// 不需要转义的 [str, str + len) 加上引号写出；分段模式下较长的直接引用
+static char* print_quoted(const char *str, int len, PrintBuffer *p) {
+    char *out, *ptr2;
+    if (p->segs && len >= CJSON_SEGMENT_REF_MIN) {
+        // 分段模式：引号写入 chunk，字符串本身直接引用
+        out = ensure(p, 1);
         if (!out) return NULL;
-        ptr2 = out;
-        *ptr2++ = '\"';
-        strcpy(ptr2, str);
-        ptr2[len] = '\"';
-        ptr2[len + 1] = 0;
+        *out = '\"';
+        p->offset++;
+        if (!segments_commit(p) || !segments_push(p->segs, str, len)) return NULL;
+        ptr2 = ensure(p, 2);
+        if (!ptr2) return NULL;
+        ptr2[0] = '\"';
+        ptr2[1] = 0;
         return out;
     }
+    out = ensure(p, len + 3);
+    if (!out) return NULL;
+    out[0] = '\"';
+    memcpy(out + 1, str, len);
+    out[len + 1] = '\"';
+    out[len + 2] = 0;
+    return out;
+}
+
+static char* print_string_ptr(const char *str, PrintBuffer *p) {
+    const char *ptr, *run;
+    char *ptr2, *out;
+    int len = 0, flag = 0;
+    unsigned char token;
 
     if (!str) {
-        if (p) out = ensure(p, len + 3);
-        else out = (char *) cJson_malloc(len + 3);
+        out = ensure(p, 3);
         if (!out) return NULL;
         strcpy(out, "\"\"");
         return out;
     }
 
-    if (p) out = ensure(p, len + 3);
-    else out = (char *) cJson_malloc(len + 3);
-    if (!out) return NULL;
+    // 转义后的长度：\" \\ \b \f \n \r \t 占 2 字节，其余控制字符写成 \uXXXX 占 6 字节
+    for (ptr = str; ; ++ptr) {
+        run = ptr;
+        ptr = scan_plain(ptr, 0);
+        len += ptr - run;
+        if (!*ptr) break;
+        token = *ptr;
+        flag = 1;
+        if (token == '\"' || token == '\\' || token == '\b' || token == '\f' ||
+            token == '\n' || token == '\r' || token == '\t') len += 2;
+        else len += 6;
+    }
+    if (!flag) return print_quoted(str, len, p);
 
+    out = ensure(p, len + 3);
+    if (!out) return NULL;
     ptr2 = out;
-    ptr = str;
     *ptr2++ = '\"';
-    while (*ptr) {
-        if ((unsigned char) *ptr > 31 && *ptr != '\"' && *ptr != '\\') {
-            *ptr2++ = *ptr++;
-        } else {
-            *ptr2++ = '\\';
-            switch (token = *ptr++) {
-                case '\\': *ptr2++ = '\\'; break;
-                case '\"': *ptr2++ = '\"'; break;
-                case '\b': *ptr2++ = 'b';  break;
-                case '\f': *ptr2++ = 'f';  break;
-                case '\n': *ptr2++ = 'n';  break;
-                case '\r': *ptr2++ = 'r';  break;
-                case '\t': *ptr2++ = 't';  break;
-                default:
-                    sprintf(ptr2, "u%04x", token);
-                    ptr2 += 5;
-                    break;
-            }
+    for (ptr = str; ; ) { // 两个需要转义的字符之间整段复制
+        run = ptr;
+        ptr = scan_plain(ptr, 0);
+        memcpy(ptr2, run, ptr - run);
+        ptr2 += ptr - run;
+        if (!*ptr) break;
+        *ptr2++ = '\\';
+        switch (token = *ptr++) {
+            case '\\': *ptr2++ = '\\'; break;
+            case '\"': *ptr2++ = '\"'; break;
+            case '\b': *ptr2++ = 'b';  break;
+            case '\f': *ptr2++ = 'f';  break;
+            case '\n': *ptr2++ = 'n';  break;
+            case '\r': *ptr2++ = 'r';  break;
+            case '\t': *ptr2++ = 't';  break;
+            default:
+                *ptr2++ = 'u';
+                *ptr2++ = '0';
+                *ptr2++ = '0';
+                *ptr2++ = hexDigits[token >> 4];
+                *ptr2++ = hexDigits[token & 15];
+                break;
         }
     }
     *ptr2++ = '\"';
-    *ptr2++ = 0;
+    *ptr2 = 0;
     return out;
 }
 
+// 原文片段本身就是合法的字符串内容，直接写出；只有规范化输出需要先解码其中的转义
 static char* print_string(CJson *item, PrintBuffer *p) {
-    return print_string_ptr(item->sValue, p);
-}
-
-static char* print_array(CJson *item, int depth, int fmt, PrintBuffer *p) {
-    char **entries;
-    char *out = NULL, *ptr, *ret;
-    int len = 5, i = 0;
-    CJson *child = item->child;
-    int entryNum = 0, fail = 0;
-    size_t tmplen = 0;
-
-    while (child) child = child->next, ++entryNum;
-    if (!entryNum) {
-        if (p) out = ensure(p, 3);
-        else out = (char *) cJson_malloc(3);
-        if (out) strcpy(out, "[]");
-        return out;
+    char *tmp, *out;
+    if (!(item->type & cJson_IsRawString)) return print_string_ptr(item->sValue, p);
+    if (!(item->type & cJson_HasEscapes) || !p->canonical) return print_quoted(item->sValue, item->iValue, p);
+    if (!(tmp = (char *) cJson_malloc(item->iValue + 1))) return NULL;
+    unescape(item->sValue, item->sValue + item->iValue, 1, tmp);
+    out = print_string_ptr(tmp, p);
+    cJson_free(tmp);
+    return out;
+}
+
+// 写一段字面量，不追加结尾的 0
+static int print_raw(PrintBuffer *p, const char *str, int len) {
+    char *ptr = ensure(p, len);
+    if (!ptr) return 0;
+    memcpy(ptr, str, len);
+    p->offset += len;
+    return 1;
+}
+
+// cJson_Print 的排版：\n 后面跟一串 \t
+static const char default_line[] = "\n\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t";
+
+// str 只含 JSON 允许的空白时返回它的长度，否则返回 -1
+static int whitespace_len(const char *str) {
+    int n;
+    for (n = 0; str[n]; n++) {
+        if (str[n] != ' ' && str[n] != '\t' && str[n] != '\n' && str[n] != '\r') return -1;
     }
+    return n;
+}
 
-    if (p) {
-        i = p->offset;
-        ptr = ensure(p, 1);
-        if (!ptr) return NULL;
-        *ptr = '[';
-        p->offset++;
-        child = item->child;
-        while (child && !fail) {
-            print_value(child, depth + 1, fmt, p);
+// 按 opts 准备格式化输出的排版，opts 为 NULL 时与 cJson_Print 相同。选项不合法时返回 0
+static int print_format(PrintBuffer *p, const CJson_PrintOptions *opts) {
+    int i, after;
+    char *ptr;
+
+    memcpy(p->colon, ":\t", 3);
+    p->colonLen = 2;
+    if (!opts) {
+        p->line = default_line;
+        p->newlineLen = p->indentLen = 1;
+        p->lineDepth = (int) sizeof(default_line) - 2;
+        return 1;
+    }
+    p->newlineLen = opts->newline ? whitespace_len(opts->newline) : 1;
+    if (opts->indent) p->indentLen = whitespace_len(opts->indent);
+    else p->indentLen = opts->indentWidth > 0 ? opts->indentWidth : 1;
+    after = opts->afterColon ? whitespace_len(opts->afterColon) : 1;
+    if (p->newlineLen < 0 || p->newlineLen > CJSON_INDENT_MAX || p->indentLen < 0 || p->indentLen > CJSON_INDENT_MAX
+        || after < 0 || after > CJSON_INDENT_MAX) return 0;
+
+    if (opts->afterColon) memcpy(p->colon + 1, opts->afterColon, after);
+    p->colonLen = 1 + after;
+    memcpy(p->lineBuf, opts->newline ? opts->newline : "\n", p->newlineLen);
+    p->lineDepth = p->indentLen ? (CJSON_LINE_BUFFER - p->newlineLen) / p->indentLen : INT_MAX;
+    for (i = 0, ptr = p->lineBuf + p->newlineLen; p->indentLen && i < p->lineDepth; i++, ptr += p->indentLen) {
+        if (opts->indent) memcpy(ptr, opts->indent, p->indentLen);
+        else if (opts->indentWidth > 0) memset(ptr, ' ', p->indentLen);
+        else *ptr = '\t';
+    }
+    p->line = p->lineBuf;
+    p->arrayLines = opts->arrayLines;
+    p->emptyBraces = 1;
+    return 1;
+}
+
+// 换行并缩进 depth 层（depth < 0 时不缩进）。一般一次 memcpy；比 line 里备好的层数更深时，缩进分几段补齐
+static int print_newline(PrintBuffer *p, int depth) {
+    int n;
+    if (depth < 0) depth = 0;
+    n = depth < p->lineDepth ? depth : p->lineDepth;
+    if (!print_raw(p, p->line, p->newlineLen + n * p->indentLen)) return 0;
+    for (depth -= n; depth > 0; depth -= n) {
+        n = depth < p->lineDepth ? depth : p->lineDepth;
+        if (!print_raw(p, p->line + p->newlineLen, n * p->indentLen)) return 0;
+    }
+    return 1;
+}
+
+// 格式化输出时空对象的写法，depth 是它所在的层数
+static int print_empty_object(PrintBuffer *p, int depth, int fmt) {
+    if (!fmt || p->emptyBraces) return print_raw(p, "{}", 2);
+    return print_raw(p, "{", 1) && print_newline(p, depth - 1) && print_raw(p, "}", 1);
+}
+
+// 数组元素之间的分隔符；元素各占一行时由 print_newline 换行
+static int print_array_separator(PrintBuffer *p, int fmt) {
+    return print_raw(p, ", ", fmt && !p->arrayLines ? 2 : 1);
+}
+
+// 紧凑数组不进栈，直接逐个写出元素，depth 是它所在的层数
+static int print_packed(CJson *item, int depth, int fmt, PrintBuffer *p) {
+    const double *values = (const double *) item->sValue;
+    int i, lines = fmt && p->arrayLines;
+    if (!print_raw(p, "[", 1)) return 0;
+    for (i = 0; i < item->iValue; i++) {
+        if (i && !print_array_separator(p, fmt)) return 0;
+        if (lines && !print_newline(p, depth + 1)) return 0;
+        if (!print_double(values[i], double_to_int(values[i]), p)) return 0;
+        p->offset = update(p);
+    }
+    if (lines && item->iValue && !print_newline(p, depth)) return 0;
+    return print_raw(p, "]", 1);
+}
+
+// 堆上的输出栈释放掉，或者交还给工作区
+static void print_stack_free(PrintBuffer *p, PrintFrame *stack, int size, PrintFrame *local) {
+    if (stack == local) return;
+    if (p->ws) {
+        p->ws->printStack = stack;
+        p->ws->printStackSize = size;
+    } else {
+        cJson_free(stack);
+    }
+}
+
+// 非递归地输出 item：数组/对象压到显式栈上，depth 是 item 所在的层数。
+// 格式化输出时，对象每个成员占一行，按 print_format 的排版缩进；数组成员默认写在同一行，用 ", " 分隔
+static char* print_value(CJson *item, int depth, int fmt, PrintBuffer *p) {
+    PrintFrame local[CJSON_LOCAL_FRAMES], *stack = local, *f;
+    int top = 0, size = CJSON_LOCAL_FRAMES, start = p->offset, ok;
+    CJson *cur = item, *next = NULL;
+    char *ptr;
+
+    if (!item) return NULL;
+    if (p->ws && p->ws->printStack) { // 借用工作区上次留下的栈
+        stack = p->ws->printStack;
+        size = p->ws->printStackSize;
+        p->ws->printStack = NULL;
+    }
+    while (1) {
+        f = top ? &stack[top - 1] : NULL;
+        if (f && (f->container->type & 255) == CJSON_Object) { // 对象成员先换行再写键名
+            if (fmt && !print_newline(p, depth)) goto fail;
+            if (!print_string_ptr(cur->string, p)) goto fail;
             p->offset = update(p);
-            if (child->next) {
-                len = fmt ? 2 : 1;
-                ptr = ensure(p, len + 1);
-                if (!ptr) return NULL;
-                *ptr++ = ',';
-                if (fmt) *ptr++ = ' ';
-                *ptr = 0;
-                p->offset += len;
-            }
-            child = child->next;
+            if (!print_raw(p, p->colon, fmt ? p->colonLen : 1)) goto fail;
+        } else if (f && fmt && p->arrayLines) {
+            if (!print_newline(p, depth)) goto fail;
         }
-        ptr = ensure(p, 2);
-        if (!ptr) return NULL;
-        *ptr++ = ']';
-        *ptr = 0;
-        out = (p->buffer) + i;
-    } else {
-        entries = (char **) cJson_malloc(entryNum * sizeof(char *));
-        if (!entries) return NULL;
-        memset(entries, 0x00, entryNum * sizeof(char *));
-        child = item->child;
-        while (child && !fail) {
-            ret = print_value(child, depth + 1, fmt, 0);
-            entries[i++] = ret;
-            if (ret) len += strlen(ret) + 2 + (fmt ? 1 : 0);
-            else fail = 1;
-            child = child->next;
-        }
-        if (!fail) out = (char *) cJSON_malloc(len);
-        if (!out) fail = 1;
-        if (fail) {
-            for (i = 0; i < entryNum; i++) {
-                if (entries[i]) cJson_free(entries[i]);
-            }
-            cJson_free(entries);
-            return NULL;
+
+        switch (cur->type & 255) {
+            case CJSON_False:  ok = print_raw(p, "false", 5); break;
+            case CJSON_True:   ok = print_raw(p, "true", 4);  break;
+            case CJSON_NULL:   ok = print_raw(p, "null", 4);  break;
+            case CJSON_Number: ok = print_number(cur, p) != NULL; p->offset = update(p); break;
+            case CJSON_String: ok = print_string(cur, p) != NULL; p->offset = update(p); break;
+            case CJSON_Array:
+            case CJSON_Object:
+                if (cur->type & cJson_IsPacked) {
+                    ok = print_packed(cur, depth, fmt, p);
+                    break;
+                }
+                if (!cur->child) { // 空数组/空对象
+                    if ((cur->type & 255) == CJSON_Array) ok = print_raw(p, "[]", 2);
+                    else ok = print_empty_object(p, depth, fmt);
+                    break;
+                }
+                if (!print_raw(p, (cur->type & 255) == CJSON_Array ? "[" : "{", 1)) goto fail;
+                if (top == size && !stack_grow((void **) &stack, &size, sizeof(PrintFrame), local)) goto fail;
+                f = &stack[top++];
+                f->container = cur;
+                f->sorted = NULL;
+                f->index = 0;
+                cur = cur->child;
+                if (p->canonical && (f->container->type & 255) == CJSON_Object) {
+                    if (!(f->sorted = sort_members(f->container, &f->count, compare_keys))) goto fail;
+                    cur = f->sorted[0];
+                }
+                ++depth;
+                continue;
+            default: ok = 0; break;
         }
-        *out = '[';
-        ptr = out + 1;
-        *ptr = 0;
-        for (i = 0; i < entryNum; i++) {
-            tmplen = strlen(entries[i]);
-            memcpy(ptr, entries[i], tmplen);
-            ptr += tmplen;
-            if (i != entryNum - 1) {
-                *ptr++ = ',';
-                if (fmt) *ptr++ = ' ';
-                *ptr = 0;
+        if (!ok) goto fail;
+
+        // 一个值结束：有下一个兄弟时写分隔符，否则依次关闭已经结束的容器
+        while (top) {
+            f = &stack[top - 1];
+            if (f->sorted) next = (++f->index < f->count) ? f->sorted[f->index] : NULL;
+            else next = cur->next;
+            if ((f->container->type & 255) == CJSON_Array) {
+                if (next) {
+                    ok = print_array_separator(p, fmt);
+                    break;
+                }
+                --depth;
+                ok = (!fmt || !p->arrayLines || print_newline(p, depth)) && print_raw(p, "]", 1);
+            } else {
+                if (next) {
+                    ok = print_raw(p, ",", 1);
+                    break;
+                }
+                --depth;
+                ok = (!fmt || print_newline(p, depth)) && print_raw(p, "}", 1);
             }
-            cJson_free(entries[i]);
+            if (!ok) goto fail;
+            if (f->sorted) cJson_free(f->sorted);
+            cur = f->container;
+            --top;
         }
-        cJson_free(entries);
-        *ptr++ = ']';
-        *ptr = 0;
+        if (!ok) goto fail;
+        if (!top) break;
+        cur = next;
+    }
+    print_stack_free(p, stack, size, local);
+    if (!(ptr = ensure(p, 1))) return NULL;
+    *ptr = 0;
+    return p->buffer + start;
+
+fail:
+    while (top--) {
+        if (stack[top].sorted) cJson_free(stack[top].sorted);
+    }
+    print_stack_free(p, stack, size, local);
+    return NULL;
+}
+
+static char* print_buffered(CJson *item, int preBuffer, int fmt, int canonical, const CJson_PrintOptions *opts) {
+    PrintBuffer p;
+    char *out;
+    memset(&p, 0x00, sizeof(PrintBuffer));
+    p.canonical = canonical;
+    if (!print_format(&p, opts)) return NULL;
+    p.buffer = (char *) cJson_malloc(preBuffer);
+    if (!p.buffer) return NULL;
+    p.length = preBuffer;
+    STATS_BEGIN();
+    out = print_value(item, 0, fmt, &p);
+    STATS_END(1, NULL);
+    if (!out && p.buffer) cJson_free(p.buffer);
+    return out;
+}
+
+char* cJson_Print(CJson *item) {
+    return print_buffered(item, 256, 1, 0, NULL);
+}
+
+char* cJson_PrintBuffered(CJson *item, int preBuffer, int fmt) {
+    return print_buffered(item, preBuffer, fmt, 0, NULL);
+}
+
+char* cJson_PrintUnformatted(CJson *item) {
+    return print_buffered(item, 256, 0, 0, NULL);
+}
+
+char* cJson_PrintCanonical(CJson *item) {
+    return print_buffered(item, 256, 0, 1, NULL);
+}
+
+char* cJson_PrintEx(CJson *item, const CJson_PrintOptions *opts) {
+    return print_buffered(item, 256, 1, 0, opts);
+}
+
+char* cJson_PrintWorkspace(CJson_Workspace *ws, CJson *item, int fmt) {
+    PrintBuffer p;
+    char *out;
+    if (!ws || !item) return NULL;
+    if (!ws->out) {
+        if (!(ws->out = (char *) cJson_malloc(256))) return NULL;
+        ws->outSize = 256;
     }
+    memset(&p, 0x00, sizeof(PrintBuffer));
+    print_format(&p, NULL);
+    p.buffer = ws->out;
+    p.length = ws->outSize;
+    p.ws = ws;
+    STATS_BEGIN();
+    out = print_value(item, 0, fmt, &p);
+    STATS_END(1, NULL);
+    ws->out = p.buffer; // ensure 可能换了缓冲区，失败时已经释放
+    ws->outSize = p.buffer ? p.length : 0;
     return out;
 }
 
-static char* print_object(CJson *item, int depth, int fmt, PrintBuffer *p) {
-    char **entries = NULL, **names = NULL;
-    char *out = NULL, *ptr, *ret, *str;
-    int len = 7, i = 0, j;
-    CJson *child = item->child;
-    int entryNum = 0, fail = 0;
-    size_t tmplen = 0;
+static int print_segments(CJson *item, int fmt, CJson_Segments *out) {
+    PrintBuffer p;
+    if (!item || !out) return 0;
+    memset(&p, 0x00, sizeof(PrintBuffer));
+    print_format(&p, NULL);
+    out->count = 0;
+    p.segs = out;
+    p.chunk = NULL;
+    if (!segments_next_chunk(&p, CJSON_SEGMENT_CHUNK)) return 0;
+    if (!print_value(item, 0, fmt, &p) || !p.buffer) return 0;
+    p.offset = update(&p);
+    return segments_commit(&p);
+}
 
-    while (child) child = child->next, ++entryNum;
-    if (!entryNum) {
-        if (p) out = ensure(p, fmt ? depth + 4 : 3);
-        else out = (char *) cJson_malloc(fmt ? depth + 4 : 3);
-        if (!out) return NULL;
-        ptr = out;
-        *ptr++ = '{';
-        if (fmt) {
-            *ptr++ = '\n';
-            for (i = 0; i < depth - 1; i++) *ptr++ = '\t';
-        }
-        *ptr++ = '}';
-        *ptr++ = 0;
-        return out;
+int cJson_PrintSegments(CJson *item, int fmt, CJson_Segments *out) {
+    int ok;
+    STATS_BEGIN();
+    ok = print_segments(item, fmt, out);
+    STATS_END(1, NULL);
+    return ok;
+}
+
+void cJson_FreeSegments(CJson_Segments *segs) {
+    SegmentChunk *c, *next;
+    if (!segs) return;
+    for (c = (SegmentChunk *) segs->chunks; c; c = next) {
+        next = c->next;
+        cJson_free(c);
     }
+    if (segs->segs) cJson_free(segs->segs);
+    memset(segs, 0x00, sizeof(CJson_Segments));
+}
 
-    if (p) {
-        i = p->offset;
-        len = fmt ? 2 : 1;
-        ptr = ensure(p, len + 1);
-        if (!ptr) return NULL;
-        *ptr++ = '{';
-        if (fmt) *ptr++ = '\n';
-        *ptr = 0;
-        p->offset += len;
-        child = item->child;
-        ++depth;
-        while (child) {
-            if (fmt) {
-                ptr = ensure(p, depth);
-                if (!ptr) return NULL;
-                for (j = 0; j < depth; j++) *ptr++ = '\t';
-                p->offset += depth;
+long cJson_WriteSegments(int fd, const CJson_Segments *segs) {
+#if defined(__unix__) || defined(__APPLE__)
+    struct iovec iov[256];
+    long total = 0;
+    ssize_t n;
+    int i = 0, j, cnt;
+
+    if (!segs) return -1;
+    while (i < segs->count) {
+        cnt = segs->count - i < 256 ? segs->count - i : 256;
+        for (j = 0; j < cnt; j++) {
+            iov[j].iov_base = (void *) segs->segs[i + j].base;
+            iov[j].iov_len = segs->segs[i + j].len;
+        }
+        j = 0;
+        while (j < cnt) {
+            n = writev(fd, iov + j, cnt - j);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                return -1;
             }
-            print_string_ptr(child->string, p);
-            p->offset = update(p);
-            
-            len = fmt ? 2 : 1;
-			ptr = ensure(p, len);
-            if (!ptr) return NULL;
-			*ptr++ = ':';
-            if (fmt) *ptr++ = '\t';
-			p->offset += len;
-
-            print_value(child, depth, fmt, p);
-            p->offset = update(p);
+            total += n;
+            // 部分写入：跳过已写完的分段，调整写了一半的分段
+            while (j < cnt && (size_t) n >= iov[j].iov_len) n -= iov[j++].iov_len;
+            if (j < cnt) {
+                iov[j].iov_base = (char *) iov[j].iov_base + n;
+                iov[j].iov_len -= n;
+            }
+        }
+        i += cnt;
+    }
+    return total;
+#else
+    (void) fd;
+    (void) segs;
+    return -1;
+#endif
+}
 
-            len = (fmt ? 1 : 0) + (child->next ? 1 : 0);
-			ptr = ensure(p, len + 1);
-            if (!ptr) return NULL;
-			if (child->next) *ptr++ = ',';
-			if (fmt) *ptr++ = '\n';
-            *ptr = 0;
-			p->offset += len;
-			child = child->next;
-        }
-		ptr = ensure(p, fmt ? (depth + 1) : 2);
-        if (!ptr) return 0;
-		if (fmt) {
-            for (i = 0; i < depth - 1; i++) *ptr++ = '\t';
-        }
-		*ptr++ = '}';
-        *ptr = 0;
-		out = (p->buffer) + i;
-    } else {
-        entries = (char **) cJSON_malloc(entryNum * sizeof(char *));
-        if (!entries) return NULL;
-        names = (char **) cJSON_malloc(entryNum * sizeof(char *));
-        if (!names) {
-            cJson_free(entries);
-            return NULL;
+/* -------------------------------------------------------------------------- */
+/*                                   binding                                  */
+/* -------------------------------------------------------------------------- */
+
+static size_t field_size(const CJson_Field *f) {
+    switch (f->type) {
+        case CJSON_FIELD_INT:
+        case CJSON_FIELD_BOOL:   return sizeof(int);
+        case CJSON_FIELD_DOUBLE: return sizeof(double);
+        case CJSON_FIELD_STRING: return sizeof(char *);
+        case CJSON_FIELD_CHARS:  return f->size;
+        case CJSON_FIELD_OBJECT: return f->schema->size;
+        default: return 0; // 数组的元素不能是数组
+    }
+}
+
+// 释放 base 所指结构体中字段 f 拥有的内存
+static void free_field(const CJson_Field *f, char *base) {
+    char **ptr = (char **) (base + f->offset);
+    size_t elemSize;
+    int i, *count;
+
+    if (f->type == CJSON_FIELD_STRING) {
+        if (*ptr) cJson_free(*ptr);
+        *ptr = NULL;
+    } else if (f->type == CJSON_FIELD_OBJECT) {
+        cJson_FreeStruct(f->schema, base + f->offset);
+    } else if (f->type == CJSON_FIELD_ARRAY) {
+        count = (int *) (base + f->countOffset);
+        elemSize = field_size(f->elem);
+        for (i = 0; *ptr && i < *count; i++) free_field(f->elem, *ptr + i * elemSize);
+        if (*ptr) cJson_free(*ptr);
+        *ptr = NULL;
+        *count = 0;
+    }
+}
+
+// 按名字找字段。成员的顺序通常与描述符一致，所以从上一个匹配字段的下一个开始找
+static const CJson_Field* find_field(const CJson_Schema *schema, const char *name, size_t len, int *hint) {
+    int i, n;
+    const CJson_Field *f;
+    for (n = 0; n < schema->count; n++) {
+        i = (*hint + n) % schema->count;
+        f = &schema->fields[i];
+        if (!strncmp(f->name, name, len) && !f->name[len]) {
+            *hint = i + 1;
+            return f;
         }
-        memset(entries, 0x00, sizeof(entryNum * sizeof(char *)));
-        memset(names, 0x00, sizeof(entryNum * sizeof(char *)));
+    }
+    return NULL;
+}
 
-        child = item->child;
-        ++depth;
-        if (fmt) len += depth;
-        while (child) {
-			names[i] = str = print_string_ptr(child->string, 0);
-			entries[i++] = ret = print_value(child, depth, fmt, 0);
-			if (str && ret) len += strlen(ret) + strlen(str) + 2 + (fmt ? 2 + depth : 0);
-            else fail = 1;
-			child = child->next;
+static const char* bind_value(const char *value, const CJson_Field *f, char *base, ParseContext *c, int depth);
+
+// 解析对象的一个键名并找到对应的字段（找不到时 *field 为 NULL），返回冒号之后的位置。
+// 不含转义的键名直接用原文比较，不需要先解码
+static const char* bind_key(const char *value, const CJson_Schema *schema, int *hint, ParseContext *c, const CJson_Field **field) {
+    const char *ptr;
+    CJson tmp;
+
+    if (*value != '\"') {
+        ep = value;
+        return NULL;
+    }
+    ptr = scan_plain(value + 1, c->strictStrings);
+    if (*ptr == '\"') {
+        *field = find_field(schema, value + 1, ptr - value - 1, hint);
+        ++ptr;
+    } else {
+        memset(&tmp, 0x00, sizeof(CJson));
+        if (!(ptr = parse_string(&tmp, value, c))) return NULL;
+        *field = find_field(schema, tmp.sValue, strlen(tmp.sValue), hint);
+        if (!is_inline(&tmp, tmp.sValue)) cJson_free(tmp.sValue);
+    }
+    ptr = skip(ptr);
+    if (*ptr != ':') {
+        ep = ptr;
+        return NULL;
+    }
+    return skip(ptr + 1);
+}
+
+static const char* bind_object(const char *value, const CJson_Schema *schema, char *base, ParseContext *c, int depth) {
+    const CJson_Field *f;
+    int hint = 0;
+
+    if (*value != '{' || depth >= c->maxDepth) {
+        ep = value;
+        if (*value == '{') ec = CJSON_ERROR_DEPTH;
+        return NULL;
+    }
+    STAT_DEPTH(depth + 1);
+    value = skip(value + 1);
+    if (*value == '}') return value + 1;
+    while (1) {
+        if (!(value = bind_key(value, schema, &hint, c, &f))) return NULL;
+        value = f ? bind_value(value, f, base, c, depth) : skip_value(value, c); // 没有描述的成员跳过
+        if (!value) return NULL;
+        value = skip(value);
+        if (*value == '}') return value + 1;
+        if (*value != ',') {
+            ep = value;
+            return NULL;
         }
+        value = skip(value + 1);
+    }
+}
 
-        if (!fail) out = (char *) cJSON_malloc(len);
-		if (!out) fail = 1;
+// 元素数组按 2 倍扩容，每个元素先清零；*count 随元素递增，失败时已经解析的元素也能被释放
+static const char* bind_array(const char *value, const CJson_Field *f, char *base, ParseContext *c, int depth) {
+    char **items = (char **) (base + f->offset), *newItems;
+    int *count = (int *) (base + f->countOffset), capacity = 0;
+    size_t elemSize = field_size(f->elem);
 
-        if (fail) {
-            for (i = 0; i < entryNum; i++) {
-                if (names[i]) cJson_free(names[i]);
-                if (entries[i]) cJson_free(entries[i]);
+    if (*value != '[' || depth >= c->maxDepth || !elemSize) {
+        ep = value;
+        if (*value == '[' && elemSize) ec = CJSON_ERROR_DEPTH;
+        return NULL;
+    }
+    free_field(f, base);
+    value = skip(value + 1);
+    if (*value == ']') return value + 1;
+    while (1) {
+        if (*count == capacity) {
+            if (capacity > (INT_MAX >> 1) || (size_t) capacity * 2 + 4 > ((size_t) -1) / elemSize) return NULL;
+            capacity = capacity ? capacity * 2 : 4;
+            if (!(newItems = (char *) cJson_malloc(capacity * elemSize))) return NULL;
+            if (*items) {
+                memcpy(newItems, *items, *count * elemSize);
+                cJson_free(*items);
             }
-            cJson_free(names);
-            cJson_free(entries);
+            *items = newItems;
+        }
+        memset(*items + *count * elemSize, 0x00, elemSize);
+        ++*count;
+        value = bind_value(value, f->elem, *items + (*count - 1) * elemSize, c, depth);
+        if (!value) return NULL;
+        value = skip(value);
+        if (*value == ']') return value + 1;
+        if (*value != ',') {
+            ep = value;
             return NULL;
         }
+        value = skip(value + 1);
+    }
+}
 
-		*out = '{';
-        ptr = out + 1;
-        if (fmt) *ptr++ = '\n';
-        *ptr = 0;
-		for (i = 0;i < entryNum; i++) {
-			if (fmt) {
-                for (j = 0; j < depth; j++) *ptr++ = '\t';
+// 把 value 处的值写到 base 所指结构体的字段 f 上；null 保持字段原值
+static const char* bind_value(const char *value, const CJson_Field *f, char *base, ParseContext *c, int depth) {
+    char *dst = base + f->offset;
+    const char *start = value;
+    size_t len;
+    CJson tmp;
+
+    if (*value == 'n' && match4(value, "null")) return value + 4;
+    switch (f->type) {
+        case CJSON_FIELD_INT:
+        case CJSON_FIELD_DOUBLE:
+            if (*value != '-' && (*value < '0' || *value > '9')) break;
+            if (!(value = parse_number(&tmp, value))) return NULL;
+            if (f->type == CJSON_FIELD_INT) *(int *) dst = tmp.iValue;
+            else *(double *) dst = tmp.dValue;
+            return value;
+        case CJSON_FIELD_BOOL:
+            if (*value == 't' && match4(value, "true")) {
+                *(int *) dst = 1;
+                return value + 4;
+            }
+            if (*value == 'f' && match4(value + 1, "alse")) {
+                *(int *) dst = 0;
+                return value + 5;
+            }
+            break;
+        case CJSON_FIELD_STRING:
+        case CJSON_FIELD_CHARS:
+            if (*value != '\"') break;
+            memset(&tmp, 0x00, sizeof(CJson));
+            if (!(value = parse_string(&tmp, value, c))) return NULL;
+            len = strlen(tmp.sValue);
+            if (f->type == CJSON_FIELD_CHARS) {
+                if (len < f->size) memcpy(dst, tmp.sValue, len + 1);
+                if (!is_inline(&tmp, tmp.sValue)) cJson_free(tmp.sValue);
+                if (len < f->size) return value;
+                ep = start; // 缓冲区放不下
+                return NULL;
             }
-			tmplen = strlen(names[i]);
-            memcpy(ptr, names[i], tmplen);
-            ptr += tmplen;
-			*ptr++ = ':';
-            if (fmt) *ptr++ = '\t';
-			strcpy(ptr, entries[i]);
-            ptr += strlen(entries[i]);
-			if (i != entryNum-1) *ptr++ = ',';
-			if (fmt) *ptr++ = '\n';
-            *ptr=0;
-			cJSON_free(names[i]);
-            cJSON_free(entries[i]);
-		}
-		
-		cJSON_free(names);
-        cJSON_free(entries);
-		if (fmt) {
-            for (i = 0; i < depth - 1; i++) *ptr++ = '\t';
-        }
-		*ptr++ = '}';
-        *ptr++ = 0;
+            if (is_inline(&tmp, tmp.sValue)) {
+                if (!(tmp.string = (char *) cJson_malloc(len + 1))) return NULL;
+                memcpy(tmp.string, tmp.sValue, len + 1);
+                tmp.sValue = tmp.string;
+            }
+            free_field(f, base);
+            *(char **) dst = tmp.sValue;
+            return value;
+        case CJSON_FIELD_OBJECT:
+            return bind_object(value, f->schema, dst, c, depth + 1);
+        case CJSON_FIELD_ARRAY:
+            return bind_array(value, f, base, c, depth + 1);
     }
-    return out;
+    ep = start; // 类型不符
+    return NULL;
 }
 
-static char* print_value(CJson *item, int depth, int fmt, PrintBuffer *p) {
-    char *out = NULL;
-    if (!item) return NULL;
-    if (p) {
-        switch ((item->type) & 255) {
-            case CJSON_False:
-                out = ensure(p, 6);
-                if (out) strcpy(out, "false");
-                break;
-            case CJSON_True:
-                out = ensure(p, 5);
-                if (out) strcpy(out, "true");
-                break;
-            case CJSON_NULL:
-                out = ensure(p, 5);
-                if (out) strcpy(out, "null");
-                break;
-            case CJSON_Number: out = print_number(item, p); break;
-            case CJSON_String: out = print_string(item, p); break;
-            case CJSON_Array:  out = print_array(item, depth, fmt, p); break;
-            case CJSON_Object: out = print_object(item, depth, fmt, p); break;
-        }
-    } else {
-        switch ((item->type) & 255) {
-            case CJSON_False:  out = cJson_strdup("false"); break;
-            case CJSON_True:   out = cJson_strdup("true");  break;
-            case CJSON_NULL:   out = cJson_strdup("null");  break;
-            case CJSON_Number: out = print_number(item, 0); break;
-            case CJSON_String: out = print_string(item, 0); break;
-            case CJSON_Array:  out = print_array(item, depth, fmt, 0); break;
-            case CJSON_Object: out = print_object(item, depth, fmt, 0); break;
+int cJson_ParseStruct(const char *value, const CJson_Schema *schema, void *out, const char **returnParseEnd, const CJson_ParseOptions *opts) {
+    const char *end;
+    ParseContext c;
+
+    ep = 0;
+    ec = CJSON_ERROR_NONE;
+    if (!value || !schema || !out) return 0;
+    parse_context_init(&c, opts);
+    STATS_BEGIN();
+    end = bind_object(skip(value), schema, (char *) out, &c, 0);
+    STATS_END(0, opts ? opts->stats : NULL);
+    parse_context_free(&c);
+    if (end && opts && opts->requireNullTerminated) {
+        end = skip(end);
+        if (*end) {
+            ep = end;
+            end = NULL;
         }
     }
-    return out;
+    if (!end) {
+        parse_failed();
+        return 0;
+    }
+    if (returnParseEnd) *returnParseEnd = end;
+    return 1;
 }
 
-char* cJson_Print(CJson *item) {
-    return print_value(item, 0, 1, 0);
+void cJson_FreeStruct(const CJson_Schema *schema, void *ptr) {
+    int i;
+    if (!schema || !ptr) return;
+    for (i = 0; i < schema->count; i++) free_field(&schema->fields[i], (char *) ptr);
 }
 
-char* cJson_PrintBuffered(CJson *item, int preBuffer, int fmt) {
+static int print_struct(const CJson_Schema *schema, const char *base, int depth, int fmt, PrintBuffer *p);
+
+// 输出 base 所指结构体的字段 f，格式与 print_value 相同
+static int print_field(const CJson_Field *f, const char *base, int depth, int fmt, PrintBuffer *p) {
+    const char *src = base + f->offset, *items;
+    size_t elemSize;
+    int i, count;
+    CJson tmp;
+
+    switch (f->type) {
+        case CJSON_FIELD_INT:
+        case CJSON_FIELD_DOUBLE:
+            if (f->type == CJSON_FIELD_INT) tmp.dValue = tmp.iValue = *(const int *) src;
+            else {
+                tmp.dValue = *(const double *) src;
+                tmp.iValue = double_to_int(tmp.dValue);
+            }
+            if (!print_number(&tmp, p)) return 0;
+            p->offset = update(p);
+            return 1;
+        case CJSON_FIELD_BOOL:
+            return *(const int *) src ? print_raw(p, "true", 4) : print_raw(p, "false", 5);
+        case CJSON_FIELD_STRING:
+        case CJSON_FIELD_CHARS:
+            if (f->type == CJSON_FIELD_STRING && !(src = *(char * const *) src)) return print_raw(p, "null", 4);
+            if (!print_string_ptr(src, p)) return 0;
+            p->offset = update(p);
+            return 1;
+        case CJSON_FIELD_OBJECT:
+            return print_struct(f->schema, src, depth, fmt, p);
+        case CJSON_FIELD_ARRAY:
+            items = *(char * const *) src;
+            count = items ? *(const int *) (base + f->countOffset) : 0;
+            elemSize = field_size(f->elem);
+            if (!print_raw(p, "[", 1)) return 0;
+            for (i = 0; i < count; i++) {
+                if (i && !print_array_separator(p, fmt)) return 0;
+                if (!print_field(f->elem, items + i * elemSize, depth + 1, fmt, p)) return 0;
+            }
+            return print_raw(p, "]", 1);
+    }
+    return 0;
+}
+
+static int print_struct(const CJson_Schema *schema, const char *base, int depth, int fmt, PrintBuffer *p) {
+    int i;
+    if (depth > CJSON_NESTING_LIMIT) return 0; // 自引用的描述符遇到了有环的数据
+    if (!schema->count) return print_empty_object(p, depth, fmt);
+    if (!print_raw(p, "{", 1)) return 0;
+    for (i = 0; i < schema->count; i++) {
+        if (i && !print_raw(p, ",", 1)) return 0;
+        if (fmt && !print_newline(p, depth + 1)) return 0;
+        if (!print_string_ptr(schema->fields[i].name, p)) return 0;
+        p->offset = update(p);
+        if (!print_raw(p, p->colon, fmt ? p->colonLen : 1)) return 0;
+        if (!print_field(&schema->fields[i], base, depth + 1, fmt, p)) return 0;
+    }
+    return (!fmt || print_newline(p, depth)) && print_raw(p, "}", 1);
+}
+
+char* cJson_PrintStruct(const CJson_Schema *schema, const void *in, int fmt) {
     PrintBuffer p;
-    p.buffer = (char *) cJson_malloc(preBuffer);
-    p.length = preBuffer;
-    p.offset = 0;
-    return print_value(item, 0, fmt, &p);
-    // return p.buffer; // ???????
+    char *ptr;
+    int ok;
+    if (!schema || !in) return NULL;
+    memset(&p, 0x00, sizeof(PrintBuffer));
+    print_format(&p, NULL);
+    p.buffer = (char *) cJson_malloc(256);
+    if (!p.buffer) return NULL;
+    p.length = 256;
+    STATS_BEGIN();
+    ok = print_struct(schema, (const char *) in, 0, fmt, &p);
+    STATS_END(1, NULL);
+    if (!ok || !(ptr = ensure(&p, 1))) {
+        if (p.buffer) cJson_free(p.buffer);
+        return NULL;
+    }
+    *ptr = 0;
+    return p.buffer;
 }
 
-char* cJson_PrintUnformatted(CJson *item) {
-    return print_value(item, 0, 0, 0);
-}
\ No newline at end of file
+/* -------------------------------------------------------------------------- */
+/*                                    stats                                   */
+/* -------------------------------------------------------------------------- */
+
+void cJson_GetStats(CJson_Stats *total, CJson_Stats *lastCall) {
+#ifdef CJSON_ENABLE_STATS
+    if (total) *total = statsTotal;
+    if (lastCall) *lastCall = statsLast;
+#else
+    if (total) memset(total, 0x00, sizeof(CJson_Stats));
+    if (lastCall) memset(lastCall, 0x00, sizeof(CJson_Stats));
+#endif
+}
+
+void cJson_ResetStats(void) {
+#ifdef CJSON_ENABLE_STATS
+    memset(&statsTotal, 0x00, sizeof(CJson_Stats));
+    memset(&statsLast, 0x00, sizeof(CJson_Stats));
+#endif
+}
@@ -6,6 +6,8 @@
 #define CJSON_H
 
 // #include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
 
 // 按照 C 语言的链接规范进行处理
 #ifdef __cplusplus
@@ -24,6 +26,43 @@ extern "C"
 
 #define cJson_IsReference 256
 #define cJson_IsConstString 512
+// 短字符串（含结尾的 0 共不超过 CJSON_INLINE_SIZE 字节）直接存放在节点的数值存储区里，
+// sValue/string 指向 inlineBuf，不单独分配。只用于 String/True/False/NULL 节点，
+// 置位后 iValue/dValue 无效；cJson_SetNumberValue/cJson_SetIntValue 会先把字符串搬到堆上再写数值
+#define cJson_IsInlineString 1024
+// string 来自键名驻留表（同时置 cJson_IsConstString），同一张表里相同的键名共享同一个指针
+#define cJson_IsInternedKey 2048
+// 只由数字组成的数组紧凑存放：元素不建节点，child 为 NULL，sValue 指向 iValue 个 double。
+// 由 cJson_CreatePackedArray 或打开 packNumbers 的解析产生。Add/Insert/Detach/Replace、GetArrayItem
+// 等需要元素节点的操作会先就地展开成普通数组；直接遍历 child 之前要调用 cJson_UnpackArray。
+// 就地展开会修改节点：只读地取元素用 cJson_GetPackedNumber，含紧凑数组的树不要用 cJson_DuplicateShared
+// 共享给别的线程后再对共享的数组调用 GetArrayItem
+#define cJson_IsPacked 4096
+// 字符串值还是原文片段：sValue 指向解析的原文中引号之后的位置，iValue 为片段的字节数，没有结尾的 0。
+// 节点的其余内联存储仍可以放键名。由打开 rawStrings 的解析产生，原文要比树活得久。cJson_GetStringValue 第一次取值时就地解码，
+// 之后就是普通的字符串节点；输出、比较、复制都不需要先解码。直接读 sValue 之前要先调用 cJson_GetStringValue。
+// 就地解码会修改节点，所以含原文片段的树不要用 cJson_DuplicateShared 共享给别的线程，
+// 先用 cJson_Duplicate 复制一份（复制时解码）再共享
+#define cJson_IsRawString 8192
+// 与 cJson_IsRawString 同时置位：片段中含有转义序列，解码后的内容与原文不同
+#define cJson_HasEscapes 16384
+// 冻结的对象（cJson_FreezeObject）：sValue 指向 iValue 个成员指针，按键名（不区分大小写）稳定排序，
+// 成员链表的顺序不变。cJson_GetObjectItem 等二分查找；增删替换成员时自动解冻，复制出来的节点不冻结
+#define cJson_IsFrozen 32768
+
+#define CJSON_INLINE_SIZE 16
+
+// 内联存储与 iValue/dValue 重叠需要匿名的结构体和联合（C11 或编译器扩展）。
+// 严格的 C99 编译器上（或定义了 CJSON_NO_ANONYMOUS_UNION 时）分开存放，节点大 16 字节，用法不变
+#if !defined(CJSON_NO_ANONYMOUS_UNION) && (defined(__GNUC__) || defined(_MSC_VER) || defined(__cplusplus) \
+    || (defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L))
+#define CJSON_ANONYMOUS_UNION 1
+#if defined(__GNUC__)
+#define CJSON_EXTENSION __extension__ // -std=c99 -pedantic 下不警告
+#else
+#define CJSON_EXTENSION
+#endif
+#endif
 
 // CJson 结构体
 typedef struct CJson {
@@ -32,11 +71,23 @@ typedef struct CJson {
     struct CJson *child; // 对于Array/Object，child指向这个Array/Object
     
     int type; // 类型
+    // 仅对子链表的头节点有意义：除了原本的父节点之外，还有多少个副本共享这条链表，见 cJson_DuplicateShared
+    int shareCount;
 
-    // ? 能不能用 union
     char *sValue;
+#ifdef CJSON_ANONYMOUS_UNION
+    CJSON_EXTENSION union {
+        CJSON_EXTENSION struct {
+            int iValue;
+            double dValue;
+        };
+        char inlineBuf[CJSON_INLINE_SIZE];
+    };
+#else
     int iValue;
     double dValue;
+    char inlineBuf[CJSON_INLINE_SIZE];
+#endif
 
     char *string;
 } CJson;
@@ -49,24 +100,81 @@ typedef struct CJson_Hooks {
 } CJson_Hooks;
 
 
-extern void cJson_Hooks_Init(CJson_Hooks* hooks);
+extern void cJson_InitHooks(CJson_Hooks* hooks);
+// 用当前的 hooks 分配和释放，cJson_Print* 返回的字符串可以用 cJson_Free 释放
+extern void* cJson_Malloc(size_t sz);
+extern void cJson_Free(void *ptr);
 
 extern CJson* cJson_Parse(const char *value);
 
 extern char* cJson_Print(CJson *item);
 extern char* cJson_PrintUnformatted(CJson *item);
 extern char* cJson_PrintBuffered(CJson *item, int prebuff, int fmt);
+// RFC 8785（JCS）规范化输出：不含空白，对象成员按键名的 UTF-16 码元排序，
+// 数字按 ECMAScript 的规则写成最短的往返表示。相等的值输出相同的文本，可用于签名或去重
+extern char* cJson_PrintCanonical(CJson *item);
+
+// cJson_PrintEx 的排版，清零后就是 cJson_Print 的格式。字符串只能含 JSON 的空白字符，各自不超过 32 字节
+typedef struct CJson_PrintOptions {
+    const char *indent;     // 每一层的缩进，NULL 表示用 indentWidth
+    int indentWidth;        // indent 为 NULL 时每层缩进的空格数，0 表示一个 \t
+    const char *newline;    // 换行符，NULL 表示 "\n"，也可以是 "\r\n"
+    const char *afterColon; // 键名的冒号后面的空白，NULL 表示 "\t"，"" 表示不加
+    int arrayLines;         // 数组元素也各占一行（默认写在同一行，用 ", " 分隔）
+} CJson_PrintOptions;
+
+// 按 opts 格式化输出（opts 为 NULL 时同 cJson_Print），空对象写成 {}。选项不合法时返回 NULL
+extern char* cJson_PrintEx(CJson *item, const CJson_PrintOptions *opts);
+
+// 分段输出（scatter-gather）：标点、数字和需要转义的文本写入池化的小缓冲区，
+// 较长且无需转义的 sValue/string 直接引用原字符串而不拷贝，结果可交给 writev。
+// CJson_Segment 与 POSIX 的 struct iovec 布局相同。
+typedef struct CJson_Segment {
+    const void *base;
+    size_t len;
+} CJson_Segment;
+
+typedef struct CJson_Segments {
+    CJson_Segment *segs;
+    int count;
+    int capacity;
+    void *chunks; // 内部使用：池化缓冲区链表
+} CJson_Segments;
+
+// out 使用前需清零；重复传入同一个 out 时复用其中的缓冲区。
+// 被引用的字符串在分段写出之前不能修改或释放。成功返回 1
+extern int cJson_PrintSegments(CJson *item, int fmt, CJson_Segments *out);
+extern void cJson_FreeSegments(CJson_Segments *segs);
+// 用 writev 写出全部分段（处理部分写入），返回写出的字节数，失败返回 -1；非 POSIX 平台总是返回 -1
+extern long cJson_WriteSegments(int fd, const CJson_Segments *segs);
 
 // 删除一个CJson实体及其所有子实体
 extern void cJson_Delete(CJson *cj);
 
 extern int cJson_GetArraySize(CJson *array);
+// 紧凑数组先就地展开（见 cJson_IsPacked）
 extern CJson* cJson_GetArrayItem(CJson *array, int item);
 extern CJson* cJson_GetObjectItem(CJson *object, const char *string);
+// 区分大小写地比较键名，RFC 8259 的语义
+extern CJson* cJson_GetObjectItemCaseSensitive(CJson *object, const char *string);
+// 字符串节点的值，原文片段（cJson_IsRawString）在这时就地解码，这一次调用会修改 item。不是字符串或内存不足时返回 NULL
+extern char* cJson_GetStringValue(CJson *item);
 
 // 用于分析解析失败的情况
 extern const char* cJson_GetErrorPtr(void);
 
+// 最近一次解析失败的原因。超出上限时 cJson_GetErrorPtr 指向超限的值、成员或字符串的开头
+#define CJSON_ERROR_NONE    0 // 没有失败，或者参数无效
+#define CJSON_ERROR_SYNTAX  1
+#define CJSON_ERROR_MEMORY  2 // cJson_malloc 失败，cJson_GetErrorPtr 为 NULL
+#define CJSON_ERROR_DEPTH   3 // 超过 maxDepth
+#define CJSON_ERROR_NODES   4 // 超过 maxNodes
+#define CJSON_ERROR_BYTES   5 // 超过 maxAllocBytes
+#define CJSON_ERROR_STRING  6 // 超过 maxStringLength
+#define CJSON_ERROR_MEMBERS 7 // 超过 maxMembers
+
+extern int cJson_GetErrorCode(void);
+
 // 创建一个对应类型的CJson项
 extern CJson* cJson_CreateFalse(void);
 extern CJson* cJson_CreateTrue(void);
@@ -82,6 +190,20 @@ extern CJson* cJson_CreateIntArray(const int *numbers, int count);
 extern CJson* cJson_CreateFloatArray(const float *numbers, int count);
 extern CJson* cJson_CreateDoubleArray(const double *numbers, int count);
 extern CJson* cJson_CreateStringArray(const char **strings, int count);
+// 紧凑的数字数组（见 cJson_IsPacked），每个元素只占一个 double
+extern CJson* cJson_CreatePackedArray(const double *numbers, int count);
+// 把数组的前 n 个元素拷贝到 out，返回数组的元素个数（可以先传 NULL、0 取得个数）；
+// item 不是数组或含有非数字的元素时返回 -1，此时 out 可能已经写入了一部分
+extern int cJson_GetNumberArray(CJson *item, double *out, int n);
+// 第 index 个元素是数字时写到 *out（可以为 NULL）并返回 1，否则返回 0。不修改 array，紧凑数组不展开
+extern int cJson_GetPackedNumber(CJson *array, int index, double *out);
+// 把紧凑数组就地展开成普通数组，不是紧凑数组时什么也不做。内存不足时返回 0
+extern int cJson_UnpackArray(CJson *array);
+// 冻结对象（见 cJson_IsFrozen），recursive 时包括所有嵌套的对象；成员太少的对象保持原样。
+// 适合建好之后只读的大树：索引每个成员只占一个指针，比哈希表省内存。
+// 工作区里的树不要冻结（索引单独分配，不会随工作区回收）。与其它副本共享的子树不会被冻结，
+// item 本身要归调用者所有（不要传入从共享副本里只读取出的节点）。内存不足时返回 0，已经冻结的对象仍然有效
+extern int cJson_FreezeObject(CJson *item, int recursive);
 
 // 向对应的Array/Object添加项
 extern void cJson_AddItemToArray(CJson *array, CJson *item);
@@ -106,23 +228,190 @@ extern CJson* cJson_DetachItemFromArray(CJson *array, int which);
 extern void cJson_DeleteItemFromArray(CJson *array, int which);
 extern CJson* cJson_DetachItemFromObject(CJson *object, const char *string);
 extern void cJson_DeleteItemFromObject(CJson *object, const char *string);
+extern CJson* cJson_DetachItemFromObjectCaseSensitive(CJson *object, const char *string);
+extern void cJson_DeleteItemFromObjectCaseSensitive(CJson *object, const char *string);
 
 // 更新数组的项
 extern void cJson_InsertItemInArray(CJson *array, int which, CJson *newItem); // 将已有项右移
 extern void cJson_ReplaceItemInArray(CJson *array, int which, CJson *newItem);
+extern void cJson_ReplaceItemInObject(CJson *object, const char *string, CJson *newItem);
+extern void cJson_ReplaceItemInObjectCaseSensitive(CJson *object, const char *string, CJson *newItem);
+
+// 结构哈希：相等（cJson_Equals）的值哈希相同，与对象成员的顺序无关；数字按 dValue 计算
+extern uint64_t cJson_Hash(CJson *item);
+// 深度比较，对象与成员的顺序无关（重复的键名按出现的先后对应），键名区分大小写。数组/对象先比较哈希
+extern int cJson_Equals(CJson *a, CJson *b);
+// 同上，但不先比较哈希。调用方已经比较过两边的 cJson_Hash 时用它，免得逐层重复计算哈希
+extern int cJson_EqualsNoHash(CJson *a, CJson *b);
 
 // 拷贝一个CJson项 // ? 拷贝？duplicate
 extern CJson* cJson_Duplicate(CJson *item, int recurse); // ? recurse???
+
+// 写时复制的拷贝：只复制 item 自身，子节点与 item 共享（引用计数），
+// 直到任何一方通过 Add/Detach/Insert/Replace/Delete 修改某一层时才复制那一层。
+// 要修改共享子树中更深的节点，须用 Mutable 版本的 Get 逐层取得，它们会沿路径复制；
+// 普通的 Get 返回的节点可能属于别的副本，只能读。含原文片段或紧凑数组的树不要这样共享给别的线程
+// （见 cJson_IsRawString、cJson_IsPacked）
+extern CJson* cJson_DuplicateShared(CJson *item);
+extern CJson* cJson_GetArrayItemMutable(CJson *array, int item);
+extern CJson* cJson_GetObjectItemMutable(CJson *object, const char *string);
 // TODO: 函数说明
 
 extern CJson* cJson_ParseWithOpts(const char *value, const char **returnParseEnd, int requireNullTerminated);
 
-// ? 压缩 ??
+// 键名驻留表：解析大量同构文档时，相同的键名只保存一份，作为常量字符串共享。
+// 表要比所有用它解析出来的 CJson 活得久；不加锁，不能被多个线程同时用来解析
+typedef struct CJson_KeyTable CJson_KeyTable;
+
+extern CJson_KeyTable* cJson_CreateKeyTable(void);
+extern void cJson_DeleteKeyTable(CJson_KeyTable *table);
+// 返回 string 在表中的共享拷贝（没有则插入），可配合 cJson_AddItemToObjectCS 使用
+extern const char* cJson_InternKey(CJson_KeyTable *table, const char *string);
+// 区分大小写；对驻留的键名只比较指针
+extern CJson* cJson_GetObjectItemInterned(CJson *object, CJson_KeyTable *table, const char *string);
+
+// 解析时数组/对象允许的最大嵌套层数（默认值）。解析、输出、复制、删除都不递归，
+// 只占用有界的调用栈，嵌套层数只受这里的限制
+#define CJSON_NESTING_LIMIT 1000
+
+// 统计计数，用于导出到监控、找出代价异常的文档。只有用 -DCJSON_ENABLE_STATS 编译库时才计数，
+// 否则计数的代码完全不编译，读到的都是 0。计数是线程局部的
+typedef struct CJson_Stats {
+    size_t nodes;       // 分配的节点数
+    size_t stringBytes; // 为字符串值和键名分配的堆内存（内联到节点中的不算）
+    size_t reallocs;    // 输出缓冲区扩容（分段模式下为换 chunk）的次数
+    size_t bytesCopied; // 扩容时搬移的字节数
+    int maxDepth;       // 解析到的最大嵌套层数
+    size_t parses;
+    size_t prints;
+    uint64_t parseNs;
+    uint64_t printNs;
+} CJson_Stats;
+
+// 当前线程的累计值和最近一次解析/输出调用的增量，不需要的传 NULL
+extern void cJson_GetStats(CJson_Stats *total, CJson_Stats *lastCall);
+extern void cJson_ResetStats(void);
+
+// 解析选项，未用到的字段置 0
+typedef struct CJson_ParseOptions {
+    int requireNullTerminated;
+    CJson_KeyTable *keys; // 非空时对象的键名从这张表中驻留
+    int maxDepth;         // 最大嵌套层数，0 表示 CJSON_NESTING_LIMIT
+    int strictStrings;    // 校验字符串的 UTF-8 编码和转义序列，无效时解析失败，cJson_GetErrorPtr 指向出错的字节
+    CJson_Stats *stats;   // 非空时把这次解析的计数累加到这里，用于按上下文统计（需要 CJSON_ENABLE_STATS）
+    int packNumbers;      // 非空的、只含数字的数组解析成紧凑数组（cJson_IsPacked）
+    int rawStrings;       // 字符串值只记下原文片段（cJson_IsRawString），用到时才解码。宽松模式下含转义或控制字符的仍立即解码
+
+    // 资源上限，0 表示不限。在解析过程中逐步检查，一超出就失败（cJson_GetErrorCode），
+    // 不会先把整棵树建出来。只计算建出来的部分，投影解析时跳过的值不算
+    size_t maxNodes;        // 节点总数
+    size_t maxAllocBytes;   // 节点、字符串和紧凑数组分配的总字节数
+    size_t maxStringLength; // 一个字符串或键名在引号之间的原文字节数
+    int maxMembers;         // 一个数组/对象的成员数
+} CJson_ParseOptions;
+
+extern CJson* cJson_ParseEx(const char *value, const char **returnParseEnd, const CJson_ParseOptions *opts);
+
+// 投影解析：只为 paths 中的路径（JSON Pointer 形式，如 "/user/name"，"*" 匹配对象的任何成员或数组的任何元素）
+// 建立节点，别的值只做语法检查后跳过，不分配内存。结果与完整解析后只留下这些路径的形状相同：路径上的容器即使
+// 没有匹配的成员也保留，中间一段遇到的不是数组/对象时不保留；数组只保留选中的元素，下标因此会变。
+// 路径格式不对时返回 NULL。opts 的用法同 cJson_ParseEx，路径上的数组不打包
+extern CJson* cJson_ParseProjected(const char *value, const char **paths, int count, const char **returnParseEnd, const CJson_ParseOptions *opts);
+
+// 分步解析：每次 cJson_ParseStep 最多处理 maxBytes 字节、maxNodes 个值（0 表示不限）就返回，
+// 事件循环可以在两步之间处理别的事情。结果与 cJson_ParseEx 相同；预算在两个值之间检查，
+// 一个很长的字符串仍然一次解析完。value 在解析完之前不能修改或释放，opts 中的 stats 不用
+typedef struct CJson_Parser CJson_Parser;
+
+#define CJSON_PARSE_FAILED  0 // 语法错误或内存不足，cJson_GetErrorPtr 指向出错的位置
+#define CJSON_PARSE_DONE    1
+#define CJSON_PARSE_PENDING 2 // 预算用完，还没有解析完
+
+extern CJson_Parser* cJson_CreateParser(const char *value, const CJson_ParseOptions *opts);
+// 返回 CJSON_PARSE_*；结束之后再调用返回同样的结果
+extern int cJson_ParseStep(CJson_Parser *parser, size_t maxBytes, size_t maxNodes);
+// 取走解析完的树（之后再取返回 NULL），没有解析完或失败时返回 NULL
+extern CJson* cJson_ParserResult(CJson_Parser *parser, const char **returnParseEnd);
+// 可以在任何时候调用，没有取走的树一起释放
+extern void cJson_DeleteParser(CJson_Parser *parser);
+
+// 工作区：在请求循环里反复解析/输出时复用内存。节点和字符串从工作区的内存块中顺序分配，
+// 解析栈、输出栈和输出缓冲区也保留下来，预热之后每次解析/输出都不再调用 cJson_malloc。
+// 不加锁，同一时间只能被一个线程使用
+typedef struct CJson_Workspace CJson_Workspace;
+
+extern CJson_Workspace* cJson_CreateWorkspace(void);
+// 释放工作区和其中的所有内存，用它解析出来的树随之失效
+extern void cJson_DeleteWorkspace(CJson_Workspace *ws);
+// 一次性回收用 ws 解析出来的所有树，内存留给之后的解析
+extern void cJson_ResetWorkspace(CJson_Workspace *ws);
+// 同 cJson_ParseEx，但树建在 ws 里，到 cJson_ResetWorkspace/cJson_DeleteWorkspace 为止有效。
+// 这样的树是只读的：不能交给 cJson_Delete，也不能增删其中的节点，需要修改或保留得更久时先用 cJson_Duplicate
+// 复制出来。opts 中的 packNumbers、rawStrings 不用（展开紧凑数组、解码原文片段都要单独分配内存）
+extern CJson* cJson_ParseWorkspace(CJson_Workspace *ws, const char *value, const char **returnParseEnd, const CJson_ParseOptions *opts);
+// 按 cJson_Print/cJson_PrintUnformatted 的格式输出到 ws 的缓冲区，不要释放结果；
+// 结果在下一次用 ws 输出或 cJson_DeleteWorkspace 之前有效，cJson_ResetWorkspace 不影响它
+extern char* cJson_PrintWorkspace(CJson_Workspace *ws, CJson *item, int fmt);
+
+// 结构体绑定：用描述符声明结构体的布局，JSON 对象直接解析到结构体里而不建立 CJson 树，
+// 结构体也可以直接输出成 JSON。字段类型：
+#define CJSON_FIELD_INT    0 // int
+#define CJSON_FIELD_DOUBLE 1 // double
+#define CJSON_FIELD_BOOL   2 // int，true/false 对应 1/0
+#define CJSON_FIELD_STRING 3 // char *，用 cJson_malloc 分配
+#define CJSON_FIELD_CHARS  4 // char[size]，放不下时解析失败
+#define CJSON_FIELD_OBJECT 5 // 嵌套的结构体，由 schema 描述
+#define CJSON_FIELD_ARRAY  6 // 指向元素数组的指针（cJson_malloc 分配），元素由 elem 描述，个数（int）在 countOffset 处
+
+typedef struct CJson_Field {
+    const char *name; // 区分大小写
+    int type;
+    size_t offset;
+    size_t size;                       // CHARS：缓冲区大小（含结尾的 0）
+    const struct CJson_Schema *schema; // OBJECT
+    const struct CJson_Field *elem;    // ARRAY：元素的描述，不用其中的 name/offset；元素不能是 ARRAY
+    size_t countOffset;                // ARRAY
+} CJson_Field;
+
+typedef struct CJson_Schema {
+    size_t size; // 结构体大小，作为数组元素时使用
+    const CJson_Field *fields;
+    int count;
+} CJson_Schema;
+
+// 声明描述符的宏，如
+//     static const CJson_Field pointFields[] = { CJSON_BIND(Point, x, CJSON_FIELD_INT), CJSON_BIND(Point, y, CJSON_FIELD_INT) };
+//     static const CJson_Schema pointSchema = CJSON_SCHEMA(Point, pointFields);
+#define CJSON_BIND(T, member, type)          { #member, type, offsetof(T, member), 0, NULL, NULL, 0 }
+#define CJSON_BIND_CHARS(T, member)          { #member, CJSON_FIELD_CHARS, offsetof(T, member), sizeof(((T *) 0)->member), NULL, NULL, 0 }
+#define CJSON_BIND_OBJECT(T, member, schema) { #member, CJSON_FIELD_OBJECT, offsetof(T, member), 0, &(schema), NULL, 0 }
+#define CJSON_BIND_ARRAY(T, member, elem, countMember) { #member, CJSON_FIELD_ARRAY, offsetof(T, member), 0, NULL, &(elem), offsetof(T, countMember) }
+#define CJSON_BIND_ELEM(type, size, schema)  { NULL, type, 0, size, schema, NULL, 0 }
+#define CJSON_SCHEMA(T, fields) { sizeof(T), fields, (int) (sizeof(fields) / sizeof((fields)[0])) }
+
+// 把一个 JSON 对象解析到 out：描述符中没有的成员跳过，没有出现的成员和值为 null 的成员保持 out 中的原值，
+// 所以 out 要先清零或填好默认值，其中 STRING/ARRAY 字段的初值必须是 NULL。
+// opts 中的 keys 不用。成功返回 1；失败返回 0，已经写入的字段同样要用 cJson_FreeStruct 释放
+extern int cJson_ParseStruct(const char *value, const CJson_Schema *schema, void *out, const char **returnParseEnd, const CJson_ParseOptions *opts);
+// 释放 STRING/ARRAY 字段分配的内存并置空，不释放 ptr 本身
+extern void cJson_FreeStruct(const CJson_Schema *schema, void *ptr);
+// 按 cJson_Print/cJson_PrintUnformatted 的格式输出结构体，值为 NULL 的 STRING 字段写成 null
+extern char* cJson_PrintStruct(const CJson_Schema *schema, const void *in, int fmt);
+
+// 原地去掉字符串外的空白和 // 、/* */ 注释
 extern void cJson_Minify(char *json);
+// 同 cJson_Minify，返回压缩后的长度
+extern size_t cJson_MinifyLength(char *json);
+// 原地压缩 [json, json + len)，不要求以 0 结尾，也不写结尾的 0；返回压缩后的长度
+extern size_t cJson_MinifyBuffer(char *json, size_t len);
+// 把 [json, json + len) 压缩到 out，out 至少要有 len + 1 字节，不能与输入重叠；以 0 结尾，返回长度
+extern size_t cJson_MinifyTo(const char *json, size_t len, char *out);
 
 // 当赋予整型值时，也要传播到dValue
-#define cJson_SetIntValue(object, value)    ((object) ? (object)->iValue = (object)->dValue = (value) : (value) )
-#define cJson_SetNumberValue(object, value) ((object) ? (object)->iValue = (object)->dValue = (value) : (value) )
+#define cJson_SetIntValue(object, value)    ((object) ? (int) cJson_SetNumberHelper(object, (double) (value)) : (value) )
+// dValue 超出 int 范围时 iValue 取边界值。内联字符串、原文片段先搬到堆上；紧凑数组、冻结对象不改
+#define cJson_SetNumberValue(object, value) ((object) ? cJson_SetNumberHelper(object, (double) (value)) : (value) )
+extern double cJson_SetNumberHelper(CJson *object, double number);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,199 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "cjson_cache.h"
+
+/* -------------------------------------------------------------------------- */
+/*                                 parameters                                 */
+/* -------------------------------------------------------------------------- */
+
+#define CACHE_MIN_BUCKETS 16
+
+typedef struct CacheEntry {
+    uint64_t hash;
+    size_t len;
+    char *text;              // 输入的拷贝，哈希相同时逐字节比较，排除碰撞
+    CJson *tree;             // 缓存持有的树，只以 cJson_DuplicateShared 的副本交给调用者
+    struct CacheEntry *prev; // LRU 链表，head 是最近使用的
+    struct CacheEntry *next;
+    struct CacheEntry *chain; // 同一个桶里的下一项
+} CacheEntry;
+
+struct CJson_ParseCache {
+    CacheEntry **buckets;
+    size_t mask;
+    CacheEntry *head;
+    CacheEntry *tail;
+    size_t maxEntries;
+    size_t maxBytes;
+    CJson_ParseCacheStats stats;
+};
+
+/* -------------------------------------------------------------------------- */
+/*                              static functions                              */
+/* -------------------------------------------------------------------------- */
+
+// 内存都经过 cJson_InitHooks 设置的分配器
+static void* cache_calloc(size_t n, size_t size) {
+    void *p;
+    if (size && n > (size_t) -1 / size) return NULL;
+    if ((p = cJson_Malloc(n * size))) memset(p, 0, n * size);
+    return p;
+}
+
+static uint64_t mix64(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+// 一次处理 8 字节，比逐字节的 FNV 快得多；输入都要完整比较一遍，哈希只用来选桶和快速排除
+static uint64_t hash_text(const char *data, size_t len) {
+    uint64_t h = 0x9E3779B97F4A7C15ULL ^ len, w;
+    while (len >= 8) {
+        memcpy(&w, data, 8);
+        h = (h ^ mix64(w)) * 0x100000001B3ULL;
+        data += 8;
+        len -= 8;
+    }
+    w = 0;
+    memcpy(&w, data, len);
+    return mix64(h ^ w);
+}
+
+static void lru_unlink(CJson_ParseCache *cache, CacheEntry *e) {
+    if (e->prev) e->prev->next = e->next;
+    else cache->head = e->next;
+    if (e->next) e->next->prev = e->prev;
+    else cache->tail = e->prev;
+    e->prev = e->next = NULL;
+}
+
+static void lru_push_front(CJson_ParseCache *cache, CacheEntry *e) {
+    e->prev = NULL;
+    e->next = cache->head;
+    if (cache->head) cache->head->prev = e;
+    else cache->tail = e;
+    cache->head = e;
+}
+
+static void free_entry(CJson_ParseCache *cache, CacheEntry *e) {
+    CacheEntry **link = &cache->buckets[e->hash & cache->mask];
+    while (*link != e) link = &(*link)->chain;
+    *link = e->chain;
+    lru_unlink(cache, e);
+    cache->stats.entries--;
+    cache->stats.bytes -= e->len;
+    cJson_Delete(e->tree);
+    cJson_Free(e->text);
+    cJson_Free(e);
+}
+
+// 条目数超过桶数时把桶数加倍；失败时保持原样，只是链变长
+static void grow_buckets(CJson_ParseCache *cache) {
+    size_t i, size = (cache->mask + 1) * 2;
+    CacheEntry **buckets = (CacheEntry **) cache_calloc(size, sizeof(CacheEntry *)), *e, *next;
+    if (!buckets) return;
+    for (i = 0; i <= cache->mask; i++) {
+        for (e = cache->buckets[i]; e; e = next) {
+            next = e->chain;
+            e->chain = buckets[e->hash & (size - 1)];
+            buckets[e->hash & (size - 1)] = e;
+        }
+    }
+    cJson_Free(cache->buckets);
+    cache->buckets = buckets;
+    cache->mask = size - 1;
+}
+
+// 从最久未用的一端淘汰，直到能放下一条长为 len 的新条目
+static void evict(CJson_ParseCache *cache, size_t len) {
+    while (cache->tail &&
+           ((cache->maxEntries && cache->stats.entries + 1 > cache->maxEntries) ||
+            (cache->maxBytes && cache->stats.bytes + len > cache->maxBytes))) {
+        free_entry(cache, cache->tail);
+        cache->stats.evictions++;
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                  functions                                 */
+/* -------------------------------------------------------------------------- */
+
+CJson_ParseCache* cJson_CreateParseCache(int maxEntries, size_t maxBytes) {
+    CJson_ParseCache *cache = (CJson_ParseCache *) cache_calloc(1, sizeof(CJson_ParseCache));
+    if (!cache) return NULL;
+    cache->buckets = (CacheEntry **) cache_calloc(CACHE_MIN_BUCKETS, sizeof(CacheEntry *));
+    if (!cache->buckets) {
+        cJson_Free(cache);
+        return NULL;
+    }
+    cache->mask = CACHE_MIN_BUCKETS - 1;
+    cache->maxEntries = maxEntries > 0 ? (size_t) maxEntries : 0;
+    cache->maxBytes = maxBytes;
+    return cache;
+}
+
+void cJson_ClearParseCache(CJson_ParseCache *cache) {
+    if (!cache) return;
+    while (cache->head) free_entry(cache, cache->head);
+}
+
+void cJson_DeleteParseCache(CJson_ParseCache *cache) {
+    if (!cache) return;
+    cJson_ClearParseCache(cache);
+    cJson_Free(cache->buckets);
+    cJson_Free(cache);
+}
+
+CJson* cJson_ParseCached(CJson_ParseCache *cache, const char *value) {
+    size_t len;
+    uint64_t hash;
+    CacheEntry *e;
+    CJson *tree;
+
+    if (!cache || !value) return cJson_Parse(value);
+    len = strlen(value);
+    hash = hash_text(value, len);
+    for (e = cache->buckets[hash & cache->mask]; e; e = e->chain) {
+        if (e->hash == hash && e->len == len && !memcmp(e->text, value, len)) {
+            cache->stats.hits++;
+            if (e != cache->head) {
+                lru_unlink(cache, e);
+                lru_push_front(cache, e);
+            }
+            return cJson_DuplicateShared(e->tree);
+        }
+    }
+
+    cache->stats.misses++;
+    if (!(tree = cJson_Parse(value))) return NULL; // 错误位置指向调用者的输入
+    if (cache->maxBytes && len > cache->maxBytes) return tree;
+
+    e = (CacheEntry *) cJson_Malloc(sizeof(CacheEntry));
+    if (!e || !(e->text = (char *) cJson_Malloc(len + 1))) { // 放不进缓存不影响结果
+        cJson_Free(e);
+        return tree;
+    }
+    memcpy(e->text, value, len + 1);
+    e->hash = hash;
+    e->len = len;
+    e->tree = tree;
+    evict(cache, len);
+    if (cache->stats.entries >= cache->mask + 1) grow_buckets(cache);
+    e->chain = cache->buckets[hash & cache->mask];
+    cache->buckets[hash & cache->mask] = e;
+    lru_push_front(cache, e);
+    cache->stats.entries++;
+    cache->stats.bytes += len;
+    return cJson_DuplicateShared(tree);
+}
+
+void cJson_GetParseCacheStats(CJson_ParseCache *cache, CJson_ParseCacheStats *stats) {
+    if (!stats) return;
+    if (!cache) memset(stats, 0, sizeof(CJson_ParseCacheStats));
+    else *stats = cache->stats;
+}
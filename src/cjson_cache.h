@@ -0,0 +1,49 @@
+/*
+    解析结果缓存：相同的输入（心跳、轮询结果、静态配置等）不再重复解析
+        CJson_ParseCache *cache = cJson_CreateParseCache(256, 1 << 20);
+        CJson *json = cJson_ParseCached(cache, text); // 用完后 cJson_Delete
+    缓存按最近使用（LRU）淘汰，本身不加锁，多个线程共用时由调用者加锁；
+    返回的副本与缓存中的树共享子节点（引用计数是原子的），可以交给其它线程。
+    缓存的树按默认选项解析，没有原文片段和紧凑数组，只读的 Get 不会修改共享的节点。
+    内存经过 cJson_InitHooks 设置的分配器，创建缓存之后不要再换 hooks
+*/
+
+#ifndef CJSON_CACHE_H
+#define CJSON_CACHE_H
+
+#include "cjson.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+typedef struct CJson_ParseCache CJson_ParseCache;
+
+typedef struct CJson_ParseCacheStats {
+    size_t hits;
+    size_t misses;    // 含解析失败的次数
+    size_t evictions;
+    size_t entries;   // 当前缓存的条目数
+    size_t bytes;     // 当前缓存的输入文本的总长度
+} CJson_ParseCacheStats;
+
+// maxEntries 限制条目数，maxBytes 限制缓存的输入文本的总长度，0 表示不限制。
+// 比 maxBytes 还长的输入照常解析，但不缓存
+extern CJson_ParseCache* cJson_CreateParseCache(int maxEntries, size_t maxBytes);
+extern void cJson_DeleteParseCache(CJson_ParseCache *cache);
+
+// 与 cJson_Parse 相同，但输入与缓存中的某一条逐字节相同时不再解析，
+// 返回缓存的树的写时复制副本（cJson_DuplicateShared），调用者可以修改，用 cJson_Delete 释放。
+// 解析失败时返回 NULL，不缓存
+extern CJson* cJson_ParseCached(CJson_ParseCache *cache, const char *value);
+
+// 丢弃所有条目，计数不清零
+extern void cJson_ClearParseCache(CJson_ParseCache *cache);
+extern void cJson_GetParseCacheStats(CJson_ParseCache *cache, CJson_ParseCacheStats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
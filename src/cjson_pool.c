@@ -0,0 +1,436 @@
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200112L // posix_memalign
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "cjson_pool.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#include <malloc.h>
+#else
+#include <pthread.h>
+#endif
+
+/* -------------------------------------------------------------------------- */
+/*                                 parameters                                 */
+/* -------------------------------------------------------------------------- */
+
+// 小块从按页对齐的页中切分，页头记录大小级别，释放时把指针按页对齐向下取整即可找到页头，
+// 不需要逐块的头部。大块用普通的 malloc，前面加一个同样格式的头部
+#define POOL_PAGE_SHIFT 12
+#define POOL_PAGE (1 << POOL_PAGE_SHIFT)
+#define POOL_HEADER 32
+#define POOL_MAGIC 0x434A504Cu
+#define POOL_LARGE (-1)
+
+// 页登记表：释放时按页号查一位，判断指针是否落在池的页里（大块所在的页不归池所有，不能读它的开头）。
+// 页号的高位选叶子，叶子是每页一位的位图，一个叶子覆盖 4GB 地址空间。超出 POOL_ADDR_BITS 的页不用
+#if UINTPTR_MAX > 0xFFFFFFFFu
+#define POOL_ADDR_BITS 48
+#else
+#define POOL_ADDR_BITS 32
+#endif
+#define POOL_LEAF_BITS 20
+#define POOL_ROOT_SIZE ((size_t) 1 << (POOL_ADDR_BITS - POOL_PAGE_SHIFT - POOL_LEAF_BITS))
+#define POOL_WORD_BITS (sizeof(uintptr_t) * 8)
+
+// 16..128 按 16 递增，另有 192/256；CJson 节点落在其中一个级别里
+#define POOL_CLASSES 10
+#define POOL_MAX_SMALL 256
+
+// 每个线程每个级别最多缓存的空闲块，超出后成批归还到全局池
+#define POOL_CACHE_MAX 512
+#define POOL_BATCH 128
+
+#if defined(_MSC_VER)
+#define POOL_TLS __declspec(thread)
+#elif defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L && !defined(__STDC_NO_THREADS__)
+#define POOL_TLS _Thread_local
+#else
+#define POOL_TLS __thread
+#endif
+
+typedef struct PoolPage {
+    unsigned magic;
+    int cls;
+    size_t size; // 大块分配时为用户请求的大小
+} PoolPage;
+
+typedef struct FreeBlock {
+    struct FreeBlock *next;
+} FreeBlock;
+
+typedef struct PoolCache {
+    FreeBlock *head[POOL_CLASSES];
+    int count[POOL_CLASSES];
+    // 计数只由所属线程写（pool_count），cJson_GetPoolStats 在别的线程里读（pool_read）
+    size_t hits;
+    size_t refills;
+    size_t misses;
+    size_t large;
+    size_t frees;
+    size_t largeFrees;
+    ptrdiff_t bytesInUse; // 跨线程释放时单个线程的值可能为负
+    struct PoolCache *next;
+} PoolCache;
+
+typedef struct PoolLeaf {
+    uintptr_t bits[((size_t) 1 << POOL_LEAF_BITS) / POOL_WORD_BITS];
+} PoolLeaf;
+
+static const size_t classSizes[POOL_CLASSES] = {
+    16, 32, 48, 64, 80, 96, 112, 128, 192, 256
+};
+
+// 全局池：各级别的空闲链表、线程缓存登记表、已退出线程的统计
+static FreeBlock *depot[POOL_CLASSES];
+static int depotCount[POOL_CLASSES];
+static PoolCache *caches;
+static PoolCache retired; // 已退出线程的统计，以及不经过线程缓存的分配和释放
+static size_t pagesRetained;
+static PoolLeaf *pageMap[POOL_ROOT_SIZE];
+
+static POOL_TLS PoolCache *tlsCache;
+static POOL_TLS int tlsDestroyed; // 线程缓存已经在线程退出时销毁，之后的分配和释放直接用全局池
+
+// 登记表只增不减：写入在锁内，读取不加锁
+#if defined(__GNUC__) || defined(__clang__)
+#define pool_load(p)     __atomic_load_n(p, __ATOMIC_ACQUIRE)
+#define pool_store(p, v) __atomic_store_n(p, v, __ATOMIC_RELEASE)
+#define pool_or(p, v)    __atomic_fetch_or(p, v, __ATOMIC_RELEASE)
+#else
+#define pool_load(p)     (*(p))
+#define pool_store(p, v) (*(p) = (v))
+#define pool_or(p, v)    (*(p) |= (v))
+#endif
+
+// 线程缓存的计数只有一个写者，不需要原子的加法，只要读写本身不被撕裂
+#if defined(__GNUC__) || defined(__clang__)
+#define pool_read(p)     __atomic_load_n(p, __ATOMIC_RELAXED)
+#define pool_count(p, n) __atomic_store_n(p, __atomic_load_n(p, __ATOMIC_RELAXED) + (n), __ATOMIC_RELAXED)
+#else
+#define pool_read(p)     (*(p))
+#define pool_count(p, n) (*(p) += (n))
+#endif
+
+#ifdef _WIN32
+static SRWLOCK poolLock = SRWLOCK_INIT;
+#define POOL_LOCK()   AcquireSRWLockExclusive(&poolLock)
+#define POOL_UNLOCK() ReleaseSRWLockExclusive(&poolLock)
+#else
+static pthread_mutex_t poolLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_key_t poolKey;
+static pthread_once_t poolOnce = PTHREAD_ONCE_INIT;
+#define POOL_LOCK()   pthread_mutex_lock(&poolLock)
+#define POOL_UNLOCK() pthread_mutex_unlock(&poolLock)
+#endif
+
+/* -------------------------------------------------------------------------- */
+/*                              static functions                              */
+/* -------------------------------------------------------------------------- */
+
+static void* page_alloc(size_t size) {
+#ifdef _WIN32
+    return _aligned_malloc(size, POOL_PAGE);
+#else
+    void *ptr;
+    return posix_memalign(&ptr, POOL_PAGE, size) ? NULL : ptr;
+#endif
+}
+
+static void page_free(void *ptr) {
+#ifdef _WIN32
+    _aligned_free(ptr);
+#else
+    free(ptr);
+#endif
+}
+
+static int size_class(size_t sz) {
+    if (sz <= 128) return sz ? (int) ((sz + 15) >> 4) - 1 : 0;
+    return sz <= 192 ? 8 : 9;
+}
+
+static PoolPage* page_of(void *ptr) {
+    return (PoolPage *) ((uintptr_t) ptr & ~(uintptr_t) (POOL_PAGE - 1));
+}
+
+static int page_registered(const PoolPage *page) {
+    uintptr_t n = (uintptr_t) page >> POOL_PAGE_SHIFT;
+    PoolLeaf *leaf;
+    if (n >> (POOL_ADDR_BITS - POOL_PAGE_SHIFT)) return 0;
+    if (!(leaf = pool_load(&pageMap[n >> POOL_LEAF_BITS]))) return 0;
+    n &= ((uintptr_t) 1 << POOL_LEAF_BITS) - 1;
+    return (int) ((pool_load(&leaf->bits[n / POOL_WORD_BITS]) >> (n % POOL_WORD_BITS)) & 1);
+}
+
+// 调用者持有锁。登记不了（地址超出范围或内存不足）时返回 0，这一页不能用
+static int page_register(const PoolPage *page) {
+    uintptr_t n = (uintptr_t) page >> POOL_PAGE_SHIFT;
+    PoolLeaf *leaf;
+    if (n >> (POOL_ADDR_BITS - POOL_PAGE_SHIFT)) return 0;
+    if (!(leaf = pageMap[n >> POOL_LEAF_BITS])) {
+        if (!(leaf = (PoolLeaf *) calloc(1, sizeof(PoolLeaf)))) return 0;
+        pool_store(&pageMap[n >> POOL_LEAF_BITS], leaf);
+    }
+    n &= ((uintptr_t) 1 << POOL_LEAF_BITS) - 1;
+    pool_or(&leaf->bits[n / POOL_WORD_BITS], (uintptr_t) 1 << (n % POOL_WORD_BITS));
+    return 1;
+}
+
+// 切分一个新页，空闲块接到 *head 上。调用者持有锁
+static int page_carve(int cls, FreeBlock **head, int *count) {
+    PoolPage *page = (PoolPage *) page_alloc(POOL_PAGE);
+    FreeBlock *b;
+    char *ptr, *end;
+
+    if (!page) return 0;
+    if (!page_register(page)) {
+        page_free(page);
+        return 0;
+    }
+    page->magic = POOL_MAGIC;
+    page->cls = cls;
+    page->size = classSizes[cls];
+    ptr = (char *) page + POOL_HEADER;
+    end = (char *) page + POOL_PAGE - classSizes[cls];
+    for (; ptr <= end; ptr += classSizes[cls]) {
+        b = (FreeBlock *) ptr;
+        b->next = *head;
+        *head = b;
+        ++*count;
+    }
+    pagesRetained++;
+    return 1;
+}
+
+// 把 cache 中第 cls 级的 n 个空闲块归还到全局池，调用者持有锁
+static void depot_put(PoolCache *cache, int cls, int n) {
+    FreeBlock *b;
+    while (n-- > 0 && (b = cache->head[cls])) {
+        cache->head[cls] = b->next;
+        cache->count[cls]--;
+        b->next = depot[cls];
+        depot[cls] = b;
+        depotCount[cls]++;
+    }
+}
+
+static void cache_flush(PoolCache *cache) {
+    int i;
+    POOL_LOCK();
+    for (i = 0; i < POOL_CLASSES; i++) depot_put(cache, i, cache->count[i]);
+    POOL_UNLOCK();
+}
+
+#ifndef _WIN32
+// 线程退出时调用。其它线程局部变量的析构函数可能在这之后还会释放节点，所以要清掉 tlsCache
+static void cache_destroy(void *arg) {
+    PoolCache *cache = (PoolCache *) arg, **pp;
+    int i;
+    POOL_LOCK();
+    for (i = 0; i < POOL_CLASSES; i++) depot_put(cache, i, cache->count[i]);
+    for (pp = &caches; *pp; pp = &(*pp)->next) {
+        if (*pp == cache) {
+            *pp = cache->next;
+            break;
+        }
+    }
+    retired.hits += cache->hits;
+    retired.refills += cache->refills;
+    retired.misses += cache->misses;
+    retired.large += cache->large;
+    retired.frees += cache->frees;
+    retired.largeFrees += cache->largeFrees;
+    retired.bytesInUse += cache->bytesInUse;
+    POOL_UNLOCK();
+    free(cache);
+    tlsCache = NULL;
+    tlsDestroyed = 1;
+}
+
+static void pool_once(void) {
+    pthread_key_create(&poolKey, cache_destroy);
+}
+#endif
+
+static PoolCache* cache_get(void) {
+    PoolCache *cache = tlsCache;
+    if (cache || tlsDestroyed) return cache;
+
+    cache = (PoolCache *) calloc(1, sizeof(PoolCache));
+    if (!cache) return NULL;
+#ifndef _WIN32
+    pthread_once(&poolOnce, pool_once);
+    pthread_setspecific(poolKey, cache);
+#endif
+    POOL_LOCK();
+    cache->next = caches;
+    caches = cache;
+    POOL_UNLOCK();
+    tlsCache = cache;
+    return cache;
+}
+
+// 线程缓存为空：先从全局池取一批，全局池也为空时切分一个新页
+static int cache_refill(PoolCache *cache, int cls) {
+    FreeBlock *b;
+    int n = POOL_BATCH, ok = 1;
+
+    POOL_LOCK();
+    while (n-- > 0 && (b = depot[cls])) {
+        depot[cls] = b->next;
+        depotCount[cls]--;
+        b->next = cache->head[cls];
+        cache->head[cls] = b;
+        cache->count[cls]++;
+    }
+    if (cache->head[cls]) {
+        pool_count(&cache->refills, 1);
+    } else if ((ok = page_carve(cls, &cache->head[cls], &cache->count[cls]))) {
+        pool_count(&cache->misses, 1);
+    }
+    POOL_UNLOCK();
+    return ok;
+}
+
+// 没有线程缓存（线程正在退出或者内存不足）时直接从全局池分配
+static void* depot_alloc(int cls) {
+    FreeBlock *b = NULL;
+    POOL_LOCK();
+    if (depot[cls]) retired.refills++;
+    else if (page_carve(cls, &depot[cls], &depotCount[cls])) retired.misses++;
+    if (depot[cls]) {
+        b = depot[cls];
+        depot[cls] = b->next;
+        depotCount[cls]--;
+        retired.bytesInUse += classSizes[cls];
+    }
+    POOL_UNLOCK();
+    return b;
+}
+
+static void* pool_malloc(size_t sz) {
+    PoolCache *cache;
+    PoolPage *header;
+    FreeBlock *b;
+    int cls;
+
+    if (sz > POOL_MAX_SMALL) {
+        if (sz > (size_t) -1 - POOL_HEADER || !(header = (PoolPage *) malloc(POOL_HEADER + sz))) return NULL;
+        header->magic = POOL_MAGIC;
+        header->cls = POOL_LARGE;
+        header->size = sz;
+        if ((cache = cache_get())) {
+            pool_count(&cache->large, 1);
+        } else {
+            POOL_LOCK();
+            retired.large++;
+            POOL_UNLOCK();
+        }
+        return (char *) header + POOL_HEADER;
+    }
+
+    cls = size_class(sz);
+    if (!(cache = cache_get())) return depot_alloc(cls);
+    if (cache->head[cls]) {
+        pool_count(&cache->hits, 1);
+    } else if (!cache_refill(cache, cls)) {
+        return NULL;
+    }
+    b = cache->head[cls];
+    cache->head[cls] = b->next;
+    cache->count[cls]--;
+    pool_count(&cache->bytesInUse, (ptrdiff_t) classSizes[cls]);
+    return b;
+}
+
+static void pool_free(void *ptr) {
+    PoolCache *cache;
+    PoolPage *page;
+    FreeBlock *b;
+    int cls;
+
+    if (!ptr) return;
+    page = page_of(ptr);
+    if (!page_registered(page)) { // 大块，头部紧挨在前面
+        page = (PoolPage *) ((char *) ptr - POOL_HEADER);
+        if (page->magic != POOL_MAGIC || page->cls != POOL_LARGE) abort(); // 不是池分配的指针
+        free(page);
+        if ((cache = cache_get())) {
+            pool_count(&cache->largeFrees, 1);
+        } else {
+            POOL_LOCK();
+            retired.largeFrees++;
+            POOL_UNLOCK();
+        }
+        return;
+    }
+    if (page->magic != POOL_MAGIC) abort(); // 页头被越界写坏了
+
+    cls = page->cls;
+    b = (FreeBlock *) ptr;
+    if (!(cache = cache_get())) { // 拿不到线程缓存时直接还给全局池
+        POOL_LOCK();
+        b->next = depot[cls];
+        depot[cls] = b;
+        depotCount[cls]++;
+        retired.frees++;
+        retired.bytesInUse -= classSizes[cls];
+        POOL_UNLOCK();
+        return;
+    }
+    b->next = cache->head[cls];
+    cache->head[cls] = b;
+    pool_count(&cache->frees, 1);
+    pool_count(&cache->bytesInUse, -(ptrdiff_t) classSizes[cls]);
+    if (++cache->count[cls] > POOL_CACHE_MAX) {
+        POOL_LOCK();
+        depot_put(cache, cls, POOL_BATCH);
+        POOL_UNLOCK();
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                  functions                                 */
+/* -------------------------------------------------------------------------- */
+
+void cJson_PoolHooks(CJson_Hooks *hooks) {
+    if (!hooks) return;
+    hooks->malloc_fn = pool_malloc;
+    hooks->free_fn = pool_free;
+}
+
+void cJson_GetPoolStats(CJson_PoolStats *stats) {
+    PoolCache *c;
+    ptrdiff_t inUse;
+    if (!stats) return;
+
+    POOL_LOCK();
+    stats->hits = retired.hits;
+    stats->refills = retired.refills;
+    stats->misses = retired.misses;
+    stats->large = retired.large;
+    stats->frees = retired.frees;
+    stats->largeFrees = retired.largeFrees;
+    inUse = retired.bytesInUse;
+    for (c = caches; c; c = c->next) { // 链表在锁内，计数由各自的线程写
+        stats->hits += pool_read(&c->hits);
+        stats->refills += pool_read(&c->refills);
+        stats->misses += pool_read(&c->misses);
+        stats->large += pool_read(&c->large);
+        stats->frees += pool_read(&c->frees);
+        stats->largeFrees += pool_read(&c->largeFrees);
+        inUse += pool_read(&c->bytesInUse);
+    }
+    stats->bytesRetained = pagesRetained * POOL_PAGE;
+    stats->bytesInUse = inUse > 0 ? (size_t) inUse : 0;
+    POOL_UNLOCK();
+}
+
+void cJson_PoolFlushThreadCache(void) {
+    if (tlsCache) cache_flush(tlsCache);
+}
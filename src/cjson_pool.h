@@ -0,0 +1,45 @@
+/*
+    CJson 节点与短字符串的内存池
+    通过 CJson_Hooks 安装：
+        CJson_Hooks hooks;
+        cJson_PoolHooks(&hooks);
+        cJson_InitHooks(&hooks);
+*/
+
+#ifndef CJSON_POOL_H
+#define CJSON_POOL_H
+
+#include "cjson.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+typedef struct CJson_PoolStats {
+    // 小块分配 = hits + refills + misses
+    size_t hits;          // 直接从线程缓存的空闲链表取得的分配次数
+    size_t refills;       // 线程缓存为空、从全局池取回一批的次数
+    size_t misses;        // 全局池也为空、需要切分新页的次数
+    size_t large;         // 超过最大级别、直接向系统分配的次数
+    size_t frees;         // 小块的释放次数
+    size_t largeFrees;    // 大块的释放次数
+    size_t bytesRetained; // 池持有的页占用的字节数（含空闲块），不含大块分配
+    size_t bytesInUse;    // 当前已分配出去的小块字节数
+} CJson_PoolStats;
+
+// 填充 malloc_fn/free_fn。安装后，之前用其它分配器分配的 CJson 不能再交给 cJson_Delete
+extern void cJson_PoolHooks(CJson_Hooks *hooks);
+
+// 汇总所有线程的统计；其它线程仍在分配时读到的是近似值
+extern void cJson_GetPoolStats(CJson_PoolStats *stats);
+
+// 把当前线程缓存的空闲块归还到全局池。POSIX 平台上线程退出时会自动归还并释放线程缓存；
+// Windows 上没有这个钩子，线程退出前要自己调用，否则缓存的空闲块一直留在那个线程的缓存里
+extern void cJson_PoolFlushThreadCache(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
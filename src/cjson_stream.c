@@ -0,0 +1,344 @@
+#if defined(__linux__) && !defined(_DEFAULT_SOURCE)
+#define _DEFAULT_SOURCE // madvise, posix_fadvise
+#endif
+#if !defined(_WIN32) && !defined(_FILE_OFFSET_BITS)
+#define _FILE_OFFSET_BITS 64 // 32 位系统上也能打开大于 2GB 的文件
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include "cjson_stream.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#define CJSON_STREAM_POSIX 1
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+/* -------------------------------------------------------------------------- */
+/*                                 parameters                                 */
+/* -------------------------------------------------------------------------- */
+
+#define STREAM_DEFAULT_WINDOW (256 * 1024)
+
+struct CJson_Stream {
+    int fd;
+    int ownFd;          // cJson_OpenStreamFile 打开的 fd，关闭流时一起关闭
+    char *buffer;       // 读 fd 时是窗口（多留一个字节放结尾的 0），映射时是映射的起点
+    size_t size;        // 窗口大小或映射的长度
+    size_t begin;       // 下一个值（或它前面的空白）在 buffer 中的位置
+    size_t end;         // 有效数据的终点
+    size_t offset;      // buffer[0] 在流中的偏移
+    size_t valueOffset; // 最近一个值在流中的偏移
+    int eof;
+    int failed;         // 读失败或内存不足
+
+    // 扫描 begin 处的值：scan 是已经扫描到的位置，之后补充数据时接着扫描
+    int scanning;
+    size_t scan;
+    int depth;
+    int inString;
+    int escape;
+
+    // 映射文件时
+    int mapped;
+    size_t window;
+    size_t tail;        // 最后一个非空白字节之后的位置，值的结尾到了这里就要拷贝出来解析
+    size_t released;    // 这之前的页已经交还
+    size_t prefetched;  // 这之前的页已经要求预读
+    char *copy;         // 需要结尾的 0 的值拷贝到这里
+    size_t copySize;
+
+    CJson_ParseOptions opts;
+};
+
+/* -------------------------------------------------------------------------- */
+/*                              static functions                              */
+/* -------------------------------------------------------------------------- */
+
+static int is_space(unsigned char ch) {
+    return ch == ' ' || ch == '\t' || ch == '\n' || ch == '\r';
+}
+
+// 数字和 true/false/null 到这些字节为止
+static int is_delimiter(unsigned char ch) {
+    return is_space(ch) || ch == ',' || ch == ':' || ch == '[' || ch == ']' || ch == '{' || ch == '}' || ch == '"' || !ch;
+}
+
+// 内存都经过 cJson_InitHooks 设置的分配器；hooks 没有 realloc，分配新的再拷贝。失败时 ptr 不变
+static void* stream_realloc(void *ptr, size_t used, size_t size) {
+    void *bigger = cJson_Malloc(size);
+    if (!bigger) return NULL;
+    if (used) memcpy(bigger, ptr, used);
+    cJson_Free(ptr);
+    return bigger;
+}
+
+static CJson_Stream* stream_new(const CJson_ParseOptions *opts, size_t window) {
+    CJson_Stream *s = (CJson_Stream *) cJson_Malloc(sizeof(CJson_Stream));
+    if (!s) return NULL;
+    memset(s, 0, sizeof(CJson_Stream));
+    s->fd = -1;
+    s->window = window ? window : STREAM_DEFAULT_WINDOW;
+    if (opts) s->opts = *opts;
+    s->opts.rawStrings = 0; // 窗口会被覆盖，映射的页会交还，字符串不能引用原文
+    return s;
+}
+
+// 从 scan 接着找 begin 处这个值的结尾。找到时 scan 停在结尾之后，返回 1；数据不够时返回 0
+static int scan_value(CJson_Stream *s) {
+    const unsigned char *buf = (const unsigned char *) s->buffer, *p = buf + s->scan, *end = buf + s->end;
+    unsigned char first = buf[s->begin];
+
+    if (first != '{' && first != '[' && first != '"') {
+        while (p < end && !is_delimiter(*p)) ++p;
+        s->scan = p - buf;
+        return p < end;
+    }
+    while (p < end) {
+        if (s->inString) { // 字符串里只关心引号和反斜杠
+            if (s->escape) {
+                s->escape = 0;
+                ++p;
+                continue;
+            }
+            while (p < end && *p != '\"' && *p != '\\') ++p;
+            if (p == end) break;
+            if (*p++ == '\\') {
+                s->escape = 1;
+                continue;
+            }
+            s->inString = 0;
+            if (s->depth) continue;
+            s->scan = p - buf;
+            return 1;
+        }
+        switch (*p++) {
+            case '\"': s->inString = 1; break;
+            case '{':
+            case '[': ++s->depth; break;
+            case '}':
+            case ']':
+                if (--s->depth > 0) break;
+                s->scan = p - buf;
+                return 1;
+        }
+    }
+    s->scan = p - buf;
+    return 0;
+}
+
+#ifdef CJSON_STREAM_POSIX
+// 读 fd 时补充数据：先把当前的值挪到窗口开头，窗口被一个值占满时翻倍
+static int refill(CJson_Stream *s) {
+    char *bigger;
+    ssize_t n;
+
+    if (s->begin) {
+        memmove(s->buffer, s->buffer + s->begin, s->end - s->begin);
+        s->offset += s->begin;
+        s->end -= s->begin;
+        s->scan -= s->begin;
+        s->begin = 0;
+    }
+    if (s->end == s->size) {
+        if (s->size > ((size_t) -1 - 1) / 2 || !(bigger = (char *) stream_realloc(s->buffer, s->end + 1, s->size * 2 + 1))) return 0;
+        s->buffer = bigger;
+        s->size *= 2;
+    }
+    do {
+        n = read(s->fd, s->buffer + s->end, s->size - s->end);
+    } while (n < 0 && errno == EINTR);
+    if (n < 0) return 0;
+    if (!n) s->eof = 1;
+    s->end += n;
+    s->buffer[s->end] = 0;
+    return 1;
+}
+
+// 映射文件时：交还 begin 之前整页的部分，预读 begin 之后的一个窗口
+static void advise(CJson_Stream *s) {
+    size_t page = (size_t) sysconf(_SC_PAGESIZE), from, to;
+    if (s->begin >= s->released + s->window) {
+        to = s->begin / page * page;
+        madvise(s->buffer + s->released, to - s->released, MADV_DONTNEED);
+        s->released = to;
+    }
+    if (s->begin + s->window > s->prefetched && s->prefetched < s->size) {
+        from = s->prefetched / page * page; // madvise 要求按页对齐
+        to = s->prefetched + 2 * s->window < s->size ? s->prefetched + 2 * s->window : s->size;
+        madvise(s->buffer + from, to - from, MADV_WILLNEED);
+        s->prefetched = to;
+    }
+}
+#else
+static int refill(CJson_Stream *s) {
+    (void) s;
+    return 0;
+}
+#endif
+
+// 解析 [begin, scan) 处的值。读 fd 时在结尾临时写一个 0；映射时数组、对象、字符串后面还有非空白字节，
+// 解析器读不到映射的外面，原地解析；其它情况拷贝出来
+static CJson* parse_value(CJson_Stream *s) {
+    char *value = s->buffer + s->begin, saved;
+    size_t len = s->scan - s->begin;
+    const char *end = NULL;
+    CJson *cj;
+
+    if (!s->mapped) {
+        saved = s->buffer[s->scan];
+        s->buffer[s->scan] = 0;
+        s->opts.requireNullTerminated = 1;
+        cj = cJson_ParseEx(value, NULL, &s->opts);
+        s->buffer[s->scan] = saved;
+        return cj;
+    }
+    if (s->scan < s->tail && (*value == '{' || *value == '[' || *value == '\"')) {
+        s->opts.requireNullTerminated = 0;
+        cj = cJson_ParseEx(value, &end, &s->opts);
+        if (cj && end != s->buffer + s->scan) { // 扫描和解析对值的范围看法一致，这里只是防备
+            cJson_Delete(cj);
+            cj = NULL;
+        }
+        return cj;
+    }
+    if (len + 1 > s->copySize) {
+        cJson_Free(s->copy);
+        if (!(s->copy = (char *) cJson_Malloc(len + 1))) {
+            s->copySize = 0;
+            s->failed = 1;
+            return NULL;
+        }
+        s->copySize = len + 1;
+    }
+    memcpy(s->copy, value, len);
+    s->copy[len] = 0;
+    s->opts.requireNullTerminated = 1;
+    return cJson_ParseEx(s->copy, NULL, &s->opts);
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                  functions                                 */
+/* -------------------------------------------------------------------------- */
+
+CJson_Stream* cJson_OpenStream(int fd, size_t window, const CJson_ParseOptions *opts) {
+#ifdef CJSON_STREAM_POSIX
+    CJson_Stream *s;
+    if (fd < 0 || !(s = stream_new(opts, window))) return NULL;
+    s->fd = fd;
+    s->size = s->window;
+    if (!(s->buffer = (char *) cJson_Malloc(s->size + 1))) {
+        cJson_Free(s);
+        return NULL;
+    }
+    s->buffer[0] = 0;
+#ifdef POSIX_FADV_SEQUENTIAL
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL); // 管道等不支持时忽略
+#endif
+    return s;
+#else
+    (void) fd;
+    (void) window;
+    (void) opts;
+    return NULL;
+#endif
+}
+
+CJson_Stream* cJson_OpenStreamFile(const char *path, size_t window, const CJson_ParseOptions *opts) {
+#ifdef CJSON_STREAM_POSIX
+    CJson_Stream *s;
+    struct stat st;
+    void *map;
+    int fd;
+
+    if (!path) return NULL;
+    do {
+        fd = open(path, O_RDONLY);
+    } while (fd < 0 && errno == EINTR);
+    if (fd < 0) return NULL;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0 && (unsigned long long) st.st_size <= (size_t) -1
+        && (map = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0)) != MAP_FAILED) {
+        if (!(s = stream_new(opts, window))) {
+            munmap(map, (size_t) st.st_size);
+            close(fd);
+            return NULL;
+        }
+        s->mapped = 1;
+        s->buffer = (char *) map;
+        s->size = s->end = s->tail = (size_t) st.st_size;
+        s->eof = 1;
+        while (s->tail && is_space((unsigned char) s->buffer[s->tail - 1])) --s->tail;
+#ifdef MADV_SEQUENTIAL
+        madvise(map, s->size, MADV_SEQUENTIAL);
+#endif
+        close(fd); // 映射不依赖 fd
+        return s;
+    }
+    if (!(s = cJson_OpenStream(fd, window, opts))) {
+        close(fd);
+        return NULL;
+    }
+    s->ownFd = 1;
+    return s;
+#else
+    (void) path;
+    (void) window;
+    (void) opts;
+    return NULL;
+#endif
+}
+
+int cJson_StreamNext(CJson_Stream *s, CJson **out) {
+    CJson *cj;
+    if (out) *out = NULL;
+    if (!s || !out) return CJSON_STREAM_IO;
+    while (!s->failed) {
+        if (!s->scanning) {
+            while (s->begin < s->end && is_space((unsigned char) s->buffer[s->begin])) ++s->begin;
+            if (s->begin == s->end) {
+                if (s->eof) return CJSON_STREAM_END;
+                if (!refill(s)) s->failed = 1;
+                continue;
+            }
+            s->scanning = 1;
+            s->scan = s->begin + 1; // 第一个字节决定怎么扫描，字符串的开头引号已经算进去了
+            s->depth = (s->buffer[s->begin] == '{' || s->buffer[s->begin] == '[');
+            s->inString = s->buffer[s->begin] == '\"';
+            s->escape = 0;
+        }
+        if (scan_value(s) || s->eof) break; // 到了结尾还不完整的值交给解析器报错
+        if (!refill(s)) s->failed = 1;
+    }
+    if (s->failed) return CJSON_STREAM_IO;
+
+#ifdef CJSON_STREAM_POSIX
+    if (s->mapped) advise(s);
+#endif
+    s->scanning = 0;
+    s->valueOffset = s->offset + s->begin;
+    cj = parse_value(s);
+    s->begin = s->scan;
+    if (s->failed) return CJSON_STREAM_IO;
+    if (!cj) return CJSON_STREAM_ERROR;
+    *out = cj;
+    return CJSON_STREAM_VALUE;
+}
+
+size_t cJson_StreamOffset(const CJson_Stream *s) {
+    return s ? s->valueOffset : 0;
+}
+
+void cJson_CloseStream(CJson_Stream *s) {
+    if (!s) return;
+#ifdef CJSON_STREAM_POSIX
+    if (s->mapped) munmap(s->buffer, s->size);
+    else cJson_Free(s->buffer);
+    if (s->ownFd) close(s->fd);
+#endif
+    cJson_Free(s->copy);
+    cJson_Free(s);
+}
@@ -0,0 +1,45 @@
+/*
+    连续多个 JSON 值的流（不要求换行分隔，如 {"a":1}{"a":2} 7 "x"），逐个读出顶层的值
+        CJson_Stream *s = cJson_OpenStreamFile("big.json", 0, NULL);
+        CJson *json;
+        while (cJson_StreamNext(s, &json) == CJSON_STREAM_VALUE) { ...; cJson_Delete(json); }
+        cJson_CloseStream(s);
+    不会把整个输入读进内存：从 fd 读时用一个滑动窗口，按需补充，只在一个值比窗口还大时扩大窗口；
+    映射文件时原地解析，预读后面的一段，已经解析过的页交还给系统。内存占用只和最大的那个值有关。
+    只支持 POSIX 平台，别的平台上 open 总是返回 NULL。内存经过 cJson_InitHooks 设置的分配器
+*/
+
+#ifndef CJSON_STREAM_H
+#define CJSON_STREAM_H
+
+#include "cjson.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+typedef struct CJson_Stream CJson_Stream;
+
+#define CJSON_STREAM_END   0 // 没有更多的值了
+#define CJSON_STREAM_VALUE 1
+#define CJSON_STREAM_ERROR 2 // 这个值解析失败（cJson_GetErrorCode，cJson_GetErrorPtr 在下次调用之前有效），下次从它后面继续
+#define CJSON_STREAM_IO    3 // 读失败（见 errno）或内存不足，之后一直返回它
+
+// 从 fd（文件、管道、套接字）顺序读取，不关闭 fd。window 是窗口的初始大小，0 表示 256KB。
+// opts 用于每一个值，rawStrings 和 requireNullTerminated 不用
+extern CJson_Stream* cJson_OpenStream(int fd, size_t window, const CJson_ParseOptions *opts);
+// 打开 path：普通文件映射到内存，window 是预读和交还页面的粒度；映射不了时（管道等）同 cJson_OpenStream
+extern CJson_Stream* cJson_OpenStreamFile(const char *path, size_t window, const CJson_ParseOptions *opts);
+
+// 读出下一个值，成功时 *out 交给调用者，用 cJson_Delete 释放；其它情况 *out 为 NULL
+extern int cJson_StreamNext(CJson_Stream *stream, CJson **out);
+// 最近一次 cJson_StreamNext 读出（或解析失败）的值在流中的字节偏移
+extern size_t cJson_StreamOffset(const CJson_Stream *stream);
+extern void cJson_CloseStream(CJson_Stream *stream);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,675 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#include <stdint.h>
+#include "cjson_utils.h"
+
+/* -------------------------------------------------------------------------- */
+/*                                 parameters                                 */
+/* -------------------------------------------------------------------------- */
+
+// 数组差分允许的最大编辑距离。Myers 算法要保存每一步的 V，占用 O(D^2) 的内存，
+// 超过后退化为按下标逐个比较
+#define DIFF_MAX_EDITS 512
+
+#define EDIT_KEEP   0
+#define EDIT_DELETE 1
+#define EDIT_INSERT 2
+
+// 对象成员的哈希表：开放寻址，slots 中存成员下标 + 1，0 表示空
+typedef struct MemberTable {
+    CJson **items;
+    char *matched;
+    int *slots;
+    int count;
+    int mask;
+} MemberTable;
+
+// 正在生成的 JSON Pointer
+typedef struct PathBuffer {
+    char *buf;
+    size_t len;
+    size_t capacity;
+} PathBuffer;
+
+/* -------------------------------------------------------------------------- */
+/*                              static functions                              */
+/* -------------------------------------------------------------------------- */
+
+static const char* str_or_empty(const char *str) {
+    return str ? str : "";
+}
+
+static uint64_t hash_str(const char *str) {
+    uint64_t h = 14695981039346656037ULL; // FNV-1a
+    for (str = str_or_empty(str); *str; ++str) {
+        h ^= (unsigned char) *str;
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+static void member_table_free(MemberTable *t) {
+    cJson_Free(t->items);
+    cJson_Free(t->matched);
+    cJson_Free(t->slots);
+}
+
+static int member_table_init(MemberTable *t, CJson *object) {
+    CJson *c;
+    size_t h;
+    int i, capacity = 8;
+
+    memset(t, 0x00, sizeof(MemberTable));
+    for (c = object->child; c; c = c->next) t->count++;
+    while (capacity < t->count * 2) capacity <<= 1;
+    t->mask = capacity - 1;
+    t->items = (CJson **) cJson_Malloc((t->count + 1) * sizeof(CJson *));
+    t->matched = (char *) cJson_Malloc(t->count + 1);
+    t->slots = (int *) cJson_Malloc(capacity * sizeof(int));
+    if (!t->items || !t->matched || !t->slots) {
+        member_table_free(t);
+        return 0;
+    }
+    memset(t->matched, 0, t->count + 1);
+    memset(t->slots, 0, capacity * sizeof(int));
+    for (i = 0, c = object->child; c; c = c->next, i++) {
+        t->items[i] = c;
+        for (h = hash_str(c->string) & t->mask; t->slots[h]; h = (h + 1) & t->mask);
+        t->slots[h] = i + 1;
+    }
+    return 1;
+}
+
+// 找第一个键名为 key 且还没有配对的成员并标记为已配对，没有时返回 -1
+static int member_table_find(MemberTable *t, const char *key) {
+    size_t h;
+    int i;
+    for (h = hash_str(key) & t->mask; (i = t->slots[h]); h = (h + 1) & t->mask) {
+        --i;
+        if (!t->matched[i] && !strcmp(str_or_empty(t->items[i]->string), str_or_empty(key))) {
+            t->matched[i] = 1;
+            return i;
+        }
+    }
+    return -1;
+}
+
+// 追加一段 "/token"，按 RFC 6901 把 ~ 和 / 写成 ~0 和 ~1。返回追加前的长度，失败返回 -1
+static long path_push(PathBuffer *p, const char *token) {
+    size_t need = 2, old = p->len, capacity;
+    const char *s;
+    char *buf;
+
+    for (s = token; *s; ++s) need += (*s == '~' || *s == '/') ? 2 : 1;
+    if (p->len + need > p->capacity) {
+        for (capacity = p->capacity ? p->capacity : 64; capacity < p->len + need; capacity *= 2);
+        if (!(buf = (char *) cJson_Malloc(capacity))) return -1;
+        if (p->len) memcpy(buf, p->buf, p->len);
+        cJson_Free(p->buf);
+        p->buf = buf;
+        p->capacity = capacity;
+    }
+    p->buf[p->len++] = '/';
+    for (s = token; *s; ++s) {
+        if (*s == '~' || *s == '/') {
+            p->buf[p->len++] = '~';
+            p->buf[p->len++] = (*s == '~') ? '0' : '1';
+        } else {
+            p->buf[p->len++] = *s;
+        }
+    }
+    p->buf[p->len] = 0;
+    return (long) old;
+}
+
+static long path_push_index(PathBuffer *p, int index) {
+    char num[16];
+    sprintf(num, "%d", index);
+    return path_push(p, num);
+}
+
+static void path_pop(PathBuffer *p, long len) {
+    p->len = (size_t) len;
+    p->buf[len] = 0;
+}
+
+// 向 patches 追加一个操作，value 交给操作对象（可以为 NULL）
+static int add_op(CJson *patches, const char *op, const char *path, CJson *value) {
+    CJson *o = cJson_CreateObject(), *name = cJson_CreateString(op), *pointer = cJson_CreateString(path);
+    if (!o || !name || !pointer) {
+        cJson_Delete(o);
+        cJson_Delete(name);
+        cJson_Delete(pointer);
+        cJson_Delete(value);
+        return 0;
+    }
+    cJson_AddItemToObject(o, "op", name);
+    cJson_AddItemToObject(o, "path", pointer);
+    if (value) cJson_AddItemToObject(o, "value", value);
+    cJson_AddItemToArray(patches, o);
+    return 1;
+}
+
+static int diff_value(CJson *from, CJson *to, PathBuffer *path, CJson *patches, int depth);
+
+static int diff_object(CJson *from, CJson *to, PathBuffer *path, CJson *patches, int depth) {
+    MemberTable t;
+    CJson *c;
+    long len;
+    int i, ok = 1;
+
+    if (!member_table_init(&t, to)) return 0;
+    for (c = from->child; c && ok; c = c->next) {
+        i = member_table_find(&t, c->string);
+        if ((len = path_push(path, str_or_empty(c->string))) < 0) {
+            ok = 0;
+            break;
+        }
+        ok = (i < 0) ? add_op(patches, "remove", path->buf, NULL) : diff_value(c, t.items[i], path, patches, depth + 1);
+        path_pop(path, len);
+    }
+    for (i = 0; i < t.count && ok; i++) {
+        if (t.matched[i]) continue;
+        if ((len = path_push(path, str_or_empty(t.items[i]->string))) < 0) {
+            ok = 0;
+            break;
+        }
+        ok = add_op(patches, "add", path->buf, cJson_Duplicate(t.items[i], 1));
+        path_pop(path, len);
+    }
+    member_table_free(&t);
+    return ok;
+}
+
+// 哈希已经算好，相同时才逐个比较子节点
+#define ELEM_EQ(i, j) (ha[i] == hb[j] && cJson_EqualsNoHash(a[i], b[j]))
+
+// 把 a 变成 b 的编辑脚本写到 script（容量 n + m），返回脚本长度。
+// 用 Myers 的 O((N+M)D) 贪心算法；编辑距离超过 DIFF_MAX_EDITS 时按下标配对，
+// 前面的元素两两对应（DELETE 后接 INSERT），多出的部分整体删除或插入
+static int edit_script(CJson **a, const uint64_t *ha, int n, CJson **b, const uint64_t *hb, int m, char *script) {
+    int limit = (n + m < DIFF_MAX_EDITS) ? n + m : DIFF_MAX_EDITS;
+    int *v = NULL, *trace = NULL, *pv, d, k, x, y, prevK, prevX, p, len = 0, found = -1;
+
+    if (n + m > 0) {
+        v = (int *) cJson_Malloc((2 * limit + 3) * sizeof(int));
+        trace = (int *) cJson_Malloc((size_t) (limit + 1) * (limit + 1) * sizeof(int));
+    }
+#define V(k) v[(k) + limit + 1]
+    if (v && trace) {
+        V(1) = 0;
+        for (d = 0; d <= limit && found < 0; d++) {
+            for (k = -d; k <= d; k += 2) {
+                if (k == -d || (k != d && V(k - 1) < V(k + 1))) x = V(k + 1); // 向下：插入 b[y]
+                else x = V(k - 1) + 1;                                        // 向右：删除 a[x]
+                y = x - k;
+                while (x < n && y < m && ELEM_EQ(x, y)) x++, y++;
+                V(k) = x;
+                if (x >= n && y >= m) {
+                    found = d;
+                    break;
+                }
+            }
+            memcpy(trace + d * d, &V(-d), (2 * d + 1) * sizeof(int)); // 第 d 步的 V(-d..d)
+        }
+    }
+#undef V
+
+    if (found >= 0) { // 从终点倒推
+        len = p = (n + m + found) / 2;
+        x = n;
+        y = m;
+        for (d = found; d > 0; d--) {
+            pv = trace + (d - 1) * (d - 1) + (d - 1); // pv[k] 是第 d - 1 步的 V(k)
+            k = x - y;
+            if (k == -d || (k != d && pv[k - 1] < pv[k + 1])) prevK = k + 1;
+            else prevK = k - 1;
+            prevX = pv[prevK];
+            while (x > prevX && y > prevX - prevK) {
+                script[--p] = EDIT_KEEP;
+                x--, y--;
+            }
+            script[--p] = (prevK == k + 1) ? EDIT_INSERT : EDIT_DELETE;
+            x = prevX;
+            y = prevX - prevK;
+        }
+        while (p > 0) script[--p] = EDIT_KEEP;
+    } else {
+        for (x = 0; x < n || x < m; x++) {
+            if (x < n) script[len++] = EDIT_DELETE;
+            if (x < m) script[len++] = EDIT_INSERT;
+        }
+    }
+    cJson_Free(v);
+    cJson_Free(trace);
+    return len;
+}
+
+static CJson* unpacked_copy(CJson *array) {
+    CJson *copy = cJson_Duplicate(array, 0);
+    if (copy && !cJson_UnpackArray(copy)) {
+        cJson_Delete(copy);
+        copy = NULL;
+    }
+    return copy;
+}
+
+// 去掉相同的首尾后对中间部分求编辑脚本。相邻的删除和插入两两配对，对配对的元素递归比较，
+// 这样数组中的对象只改了一个成员时，生成的是对这个成员的操作而不是替换整个元素
+static int diff_array(CJson *from, CJson *to, PathBuffer *path, CJson *patches, int depth) {
+    CJson **a = NULL, **b = NULL, *c, *fromCopy = NULL, *toCopy = NULL;
+    uint64_t *ha = NULL, *hb = NULL;
+    char *script = NULL;
+    int n = 0, m = 0, pre = 0, suf = 0, len, i, j, x, y, idx, dels, ins, pairs, ok = 0;
+    long plen;
+
+    // 紧凑数组没有元素节点，对展开的临时副本求差异，from/to 本身不动
+    if (((from->type & cJson_IsPacked) && !(from = fromCopy = unpacked_copy(from)))
+        || ((to->type & cJson_IsPacked) && !(to = toCopy = unpacked_copy(to)))) goto done;
+    for (c = from->child; c; c = c->next) n++;
+    for (c = to->child; c; c = c->next) m++;
+    a = (CJson **) cJson_Malloc((n + 1) * sizeof(CJson *));
+    b = (CJson **) cJson_Malloc((m + 1) * sizeof(CJson *));
+    ha = (uint64_t *) cJson_Malloc((n + 1) * sizeof(uint64_t));
+    hb = (uint64_t *) cJson_Malloc((m + 1) * sizeof(uint64_t));
+    script = (char *) cJson_Malloc(n + m + 1);
+    if (!a || !b || !ha || !hb || !script) goto done;
+    for (i = 0, c = from->child; c; c = c->next, i++) ha[i] = cJson_Hash(a[i] = c);
+    for (i = 0, c = to->child; c; c = c->next, i++) hb[i] = cJson_Hash(b[i] = c);
+
+    while (pre < n && pre < m && ELEM_EQ(pre, pre)) pre++;
+    while (suf < n - pre && suf < m - pre && ELEM_EQ(n - 1 - suf, m - 1 - suf)) suf++;
+    len = edit_script(a + pre, ha + pre, n - pre - suf, b + pre, hb + pre, m - pre - suf, script);
+
+    ok = 1;
+    x = y = 0;
+    idx = pre; // 已经执行过前面的操作之后，当前元素的下标
+    for (i = 0; i < len && ok; ) {
+        if (script[i] == EDIT_KEEP) {
+            i++, x++, y++, idx++;
+            continue;
+        }
+        for (dels = ins = 0; i < len && script[i] != EDIT_KEEP; i++) {
+            if (script[i] == EDIT_DELETE) dels++;
+            else ins++;
+        }
+        pairs = dels < ins ? dels : ins;
+        for (j = 0; j < dels + ins - pairs && ok; j++) {
+            if ((plen = path_push_index(path, idx)) < 0) {
+                ok = 0;
+                break;
+            }
+            if (j < pairs) ok = diff_value(a[pre + x + j], b[pre + y + j], path, patches, depth + 1);
+            else if (dels > ins) ok = add_op(patches, "remove", path->buf, NULL);
+            else ok = add_op(patches, "add", path->buf, cJson_Duplicate(b[pre + y + j], 1));
+            path_pop(path, plen);
+            if (j < pairs || dels < ins) idx++; // 删除后后面的元素前移，下标不变
+        }
+        x += dels;
+        y += ins;
+    }
+
+done:
+    cJson_Free(a);
+    cJson_Free(b);
+    cJson_Free(ha);
+    cJson_Free(hb);
+    cJson_Free(script);
+    cJson_Delete(fromCopy);
+    cJson_Delete(toCopy);
+    return ok;
+}
+
+#undef ELEM_EQ
+
+// 用 API 构建的树可能比解析器允许的更深，递归层数超过 CJSON_NESTING_LIMIT 时失败
+static int diff_value(CJson *from, CJson *to, PathBuffer *path, CJson *patches, int depth) {
+    int type = from->type & 255;
+    if (depth > CJSON_NESTING_LIMIT) return 0;
+    if (type == (to->type & 255)) {
+        switch (type) {
+            case CJSON_Number:
+                if (from->dValue == to->dValue) return 1;
+                break;
+            case CJSON_String:
+                if (cJson_Equals(from, to)) return 1; // 原文片段不必先解码
+                break;
+            case CJSON_Array:
+                return diff_array(from, to, path, patches, depth);
+            case CJSON_Object:
+                return diff_object(from, to, path, patches, depth);
+            default:
+                return 1;
+        }
+    }
+    return add_op(patches, "replace", path->buf, cJson_Duplicate(to, 1));
+}
+
+// 取出 JSON Pointer 的下一段（ptr 指向 '/'），反转义后写到 token，返回这一段之后的位置
+static const char* pointer_next(const char *ptr, char *token) {
+    for (++ptr; *ptr && *ptr != '/'; ) {
+        if (*ptr != '~') {
+            *token++ = *ptr++;
+            continue;
+        }
+        if (ptr[1] != '0' && ptr[1] != '1') return NULL;
+        *token++ = (ptr[1] == '0') ? '~' : '/';
+        ptr += 2;
+    }
+    *token = 0;
+    return ptr;
+}
+
+// 数组下标：十进制，除了 "0" 不能以 0 开头。不合法时返回 -1
+static int array_index(const char *token) {
+    long n = 0;
+    if (!*token || (token[0] == '0' && token[1])) return -1;
+    for (; *token; ++token) {
+        if (*token < '0' || *token > '9' || n > INT_MAX / 10) return -1;
+        n = n * 10 + (*token - '0');
+    }
+    return n <= INT_MAX ? (int) n : -1;
+}
+
+// token 对应的成员或元素在子链表中的位置，没有时返回 -1
+static int child_index(CJson *parent, const char *token) {
+    CJson *c;
+    int i = 0;
+    if ((parent->type & 255) == CJSON_Array) {
+        i = array_index(token);
+        return (i >= 0 && i < cJson_GetArraySize(parent)) ? i : -1;
+    }
+    if ((parent->type & 255) != CJSON_Object) return -1;
+    for (c = parent->child; c; c = c->next, i++) {
+        if (c->string && !strcmp(c->string, token)) return i;
+    }
+    return -1;
+}
+
+// 沿 pointer 中 end 之前的部分走到目标节点。forWrite 时用 Mutable 版本的 Get 逐层取得，
+// 沿路复制与快照共享的子树
+static CJson* resolve(CJson *object, const char *pointer, const char *end, char *token, int forWrite) {
+    int i;
+    while (object && pointer < end) {
+        if (*pointer != '/' || !(pointer = pointer_next(pointer, token))) return NULL;
+        if ((i = child_index(object, token)) < 0) return NULL;
+        object = forWrite ? cJson_GetArrayItemMutable(object, i) : cJson_GetArrayItem(object, i);
+    }
+    return object;
+}
+
+// 可写的父节点，最后一段反转义后写到 token
+static CJson* resolve_parent(CJson *object, const char *path, char *token) {
+    const char *last = strrchr(path, '/');
+    if (!last || !(object = resolve(object, path, last, token, 1))) return NULL;
+    return pointer_next(last, token) ? object : NULL;
+}
+
+static int in_inline_buf(const char *buf, const char *ptr) {
+    return ptr && ptr >= buf && ptr < buf + CJSON_INLINE_SIZE;
+}
+
+// 把 src 的值（类型、子节点、字符串和数值存储区）搬到 dst，dst 的前后节点和键名不变。
+// srcBuf 是 src 原来的数值存储区，内联的 sValue 要换到 dst 的存储区上
+static void move_content(CJson *dst, const CJson *src, const char *srcBuf, int keyFlags) {
+    dst->type = (src->type & ~(cJson_IsConstString | cJson_IsInternedKey)) | keyFlags;
+    dst->child = src->child;
+#ifndef CJSON_ANONYMOUS_UNION
+    dst->iValue = src->iValue;
+    dst->dValue = src->dValue;
+#endif
+    memcpy(dst->inlineBuf, src->inlineBuf, CJSON_INLINE_SIZE);
+    dst->sValue = src->sValue;
+    if (in_inline_buf(srcBuf, src->sValue)) dst->sValue = dst->inlineBuf + (src->sValue - srcBuf);
+}
+
+// 用 item 的值替换 root（path 为 "" 的操作），item 带着 root 原来的值被释放。
+// root 的键名内联在数值存储区里时没法保留，返回 0
+static int replace_root(CJson *root, CJson *item) {
+    CJson old;
+    if (in_inline_buf(root->inlineBuf, root->string)) {
+        cJson_Delete(item);
+        return 0;
+    }
+    if (in_inline_buf(item->inlineBuf, item->string) || (item->type & cJson_IsConstString)) {
+        item->string = NULL; // 不需要释放
+        item->type &= ~(cJson_IsConstString | cJson_IsInternedKey);
+    }
+    old = *root;
+    move_content(root, item, item->inlineBuf, old.type & (cJson_IsConstString | cJson_IsInternedKey));
+    move_content(item, &old, root->inlineBuf, 0);
+    cJson_Delete(item);
+    return 1;
+}
+
+// value 交给 object，失败时释放
+static int patch_add(CJson *object, const char *path, CJson *value, char *token) {
+    CJson *parent;
+    int i;
+
+    if (!value) return 0;
+    if (!*path) return replace_root(object, value);
+    if (!(parent = resolve_parent(object, path, token))) goto fail;
+    if ((parent->type & 255) == CJSON_Array) {
+        if (!strcmp(token, "-")) i = cJson_GetArraySize(parent);
+        else if ((i = array_index(token)) < 0 || i > cJson_GetArraySize(parent)) goto fail;
+        cJson_InsertItemInArray(parent, i, value);
+        return 1;
+    }
+    if ((parent->type & 255) != CJSON_Object) goto fail;
+    if (cJson_GetObjectItemCaseSensitive(parent, token)) cJson_ReplaceItemInObjectCaseSensitive(parent, token, value);
+    else cJson_AddItemToObject(parent, token, value);
+    return 1;
+
+fail:
+    cJson_Delete(value);
+    return 0;
+}
+
+static int patch_replace(CJson *object, const char *path, CJson *value, char *token) {
+    CJson *parent;
+    int i;
+
+    if (!value) return 0;
+    if (!*path) return replace_root(object, value);
+    if (!(parent = resolve_parent(object, path, token)) || (i = child_index(parent, token)) < 0) {
+        cJson_Delete(value);
+        return 0;
+    }
+    if ((parent->type & 255) == CJSON_Object) cJson_ReplaceItemInObjectCaseSensitive(parent, token, value);
+    else cJson_ReplaceItemInArray(parent, i, value);
+    return 1;
+}
+
+static CJson* patch_detach(CJson *object, const char *path, char *token) {
+    CJson *parent;
+    int i;
+    if (!*path || !(parent = resolve_parent(object, path, token)) || (i = child_index(parent, token)) < 0) return NULL;
+    return cJson_DetachItemFromArray(parent, i);
+}
+
+static int apply_op(CJson *object, CJson *op, char *token) {
+    CJson *name = cJson_GetObjectItemCaseSensitive(op, "op");
+    CJson *pathItem = cJson_GetObjectItemCaseSensitive(op, "path");
+    CJson *fromItem = cJson_GetObjectItemCaseSensitive(op, "from");
+    CJson *value = cJson_GetObjectItemCaseSensitive(op, "value"), *item;
+    const char *path, *from;
+    size_t len;
+
+    if (!name || !pathItem || (name->type & 255) != CJSON_String || (pathItem->type & 255) != CJSON_String) return 0;
+    path = str_or_empty(cJson_GetStringValue(pathItem));
+    from = (fromItem && (fromItem->type & 255) == CJSON_String) ? str_or_empty(cJson_GetStringValue(fromItem)) : NULL;
+    if (!cJson_GetStringValue(name)) return 0;
+
+    if (!strcmp(name->sValue, "add")) return value && patch_add(object, path, cJson_Duplicate(value, 1), token);
+    if (!strcmp(name->sValue, "replace")) return value && patch_replace(object, path, cJson_Duplicate(value, 1), token);
+    if (!strcmp(name->sValue, "remove")) {
+        if (!(item = patch_detach(object, path, token))) return 0;
+        cJson_Delete(item);
+        return 1;
+    }
+    if (!strcmp(name->sValue, "test")) {
+        item = resolve(object, path, path + strlen(path), token, 0);
+        return value && item && cJson_Equals(item, value);
+    }
+    if (!from) return 0;
+    if (!strcmp(name->sValue, "copy")) {
+        item = resolve(object, from, from + strlen(from), token, 0);
+        return item && patch_add(object, path, cJson_Duplicate(item, 1), token);
+    }
+    if (!strcmp(name->sValue, "move")) {
+        len = strlen(from);
+        if (!strcmp(from, path)) return resolve(object, from, from + len, token, 0) != NULL;
+        if (!strncmp(from, path, len) && path[len] == '/') return 0; // 不能移到自己的子节点下
+        if (!(item = patch_detach(object, from, token))) return 0;
+        return patch_add(object, path, item, token);
+    }
+    return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+/*                                  functions                                 */
+/* -------------------------------------------------------------------------- */
+
+CJson* cJson_GetPointer(CJson *object, const char *pointer) {
+    char *token;
+    size_t len;
+    if (!object || !pointer) return NULL;
+    len = strlen(pointer);
+    if (!(token = (char *) cJson_Malloc(len + 1))) return NULL;
+    object = resolve(object, pointer, pointer + len, token, 0);
+    cJson_Free(token);
+    return object;
+}
+
+CJson* cJson_Diff(CJson *from, CJson *to) {
+    PathBuffer path;
+    CJson *patches;
+
+    if (!from || !to || !(patches = cJson_CreateArray())) return NULL;
+    memset(&path, 0x00, sizeof(PathBuffer));
+    if (!(path.buf = (char *) cJson_Malloc(64))) {
+        cJson_Delete(patches);
+        return NULL;
+    }
+    path.buf[0] = 0;
+    path.capacity = 64;
+    if (!diff_value(from, to, &path, patches, 0)) {
+        cJson_Delete(patches);
+        patches = NULL;
+    }
+    cJson_Free(path.buf);
+    return patches;
+}
+
+int cJson_ApplyPatch(CJson *object, CJson *patches) {
+    CJson *snapshot, *op, *c;
+    char *token;
+    size_t len, maxLen = 0;
+    int ok = 1;
+
+    if (!object || !patches || (patches->type & 255) != CJSON_Array) return 0;
+    if ((patches->type & cJson_IsPacked) && patches->iValue) return 0; // 紧凑数组里只有数字，不是操作
+    if (in_inline_buf(object->inlineBuf, object->string)) return 0; // 失败时没法恢复
+    for (op = patches->child; op; op = op->next) { // token 要能放下最长的 path/from
+        if ((op->type & 255) != CJSON_Object) return 0;
+        for (c = op->child; c; c = c->next) {
+            if ((c->type & 255) == CJSON_String && cJson_GetStringValue(c) && (len = strlen(c->sValue)) > maxLen) maxLen = len;
+        }
+    }
+    if (!(token = (char *) cJson_Malloc(maxLen + 1))) return 0;
+    if (!(snapshot = cJson_DuplicateShared(object))) {
+        cJson_Free(token);
+        return 0;
+    }
+    for (op = patches->child; op && ok; op = op->next) ok = apply_op(object, op, token);
+    if (ok) cJson_Delete(snapshot);
+    else replace_root(object, snapshot);
+    cJson_Free(token);
+    return ok;
+}
+
+// 嵌套超过 CJSON_NESTING_LIMIT 层时把 *ok 置 0，返回的树由调用方释放
+static CJson* merge_patch(CJson *target, CJson *patch, int depth, int *ok) {
+    CJson *p, *child;
+    int i;
+
+    if (!patch) return target;
+    if ((patch->type & 255) != CJSON_Object) {
+        cJson_Delete(target);
+        return cJson_Duplicate(patch, 1);
+    }
+    if (depth > CJSON_NESTING_LIMIT) {
+        *ok = 0;
+        return target;
+    }
+    if (!target || (target->type & 255) != CJSON_Object) {
+        cJson_Delete(target);
+        if (!(target = cJson_CreateObject())) return NULL;
+    }
+    for (p = patch->child; p && *ok; p = p->next) {
+        if (!p->string) continue;
+        i = child_index(target, p->string);
+        if ((p->type & 255) == CJSON_NULL) {
+            if (i >= 0) cJson_DeleteItemFromArray(target, i);
+        } else if (i >= 0 && (p->type & 255) == CJSON_Object && (cJson_GetArrayItem(target, i)->type & 255) == CJSON_Object) {
+            merge_patch(cJson_GetArrayItemMutable(target, i), p, depth + 1, ok); // 两边都是对象，原地合并
+        } else if ((child = merge_patch(NULL, p, depth + 1, ok))) {
+            if (!*ok) cJson_Delete(child);
+            else if (i >= 0) cJson_ReplaceItemInObjectCaseSensitive(target, p->string, child);
+            else cJson_AddItemToObject(target, p->string, child);
+        }
+    }
+    return target;
+}
+
+CJson* cJson_MergePatch(CJson *target, CJson *patch) {
+    int ok = 1;
+    target = merge_patch(target, patch, 0, &ok);
+    if (!ok) {
+        cJson_Delete(target);
+        return NULL;
+    }
+    return target;
+}
+
+static CJson* generate_merge_patch(CJson *from, CJson *to, int depth) {
+    MemberTable t;
+    CJson *patch, *c, *sub;
+    int i, ok = 1;
+
+    if (!to) return NULL;
+    if (!from || (from->type & 255) != CJSON_Object || (to->type & 255) != CJSON_Object) return cJson_Duplicate(to, 1);
+    if (depth > CJSON_NESTING_LIMIT || !(patch = cJson_CreateObject())) return NULL;
+    if (!member_table_init(&t, to)) {
+        cJson_Delete(patch);
+        return NULL;
+    }
+    for (c = from->child; c && ok; c = c->next) {
+        if ((i = member_table_find(&t, c->string)) < 0) {
+            cJson_AddItemToObject(patch, str_or_empty(c->string), cJson_CreateNull());
+        } else if ((c->type & 255) == CJSON_Object && (t.items[i]->type & 255) == CJSON_Object) {
+            // 子对象失败（内存不足或嵌套太深）时整个补丁失败，不能当作没有差异
+            if (!(sub = generate_merge_patch(c, t.items[i], depth + 1))) ok = 0;
+            else if (sub->child) cJson_AddItemToObject(patch, str_or_empty(c->string), sub);
+            else cJson_Delete(sub);
+        } else if (!cJson_Equals(c, t.items[i])) {
+            cJson_AddItemToObject(patch, str_or_empty(c->string), cJson_Duplicate(t.items[i], 1));
+        }
+    }
+    for (i = 0; i < t.count && ok; i++) {
+        if (!t.matched[i]) cJson_AddItemToObject(patch, str_or_empty(t.items[i]->string), cJson_Duplicate(t.items[i], 1));
+    }
+    member_table_free(&t);
+    if (!ok) {
+        cJson_Delete(patch);
+        return NULL;
+    }
+    return patch;
+}
+
+CJson* cJson_GenerateMergePatch(CJson *from, CJson *to) {
+    return generate_merge_patch(from, to, 0);
+}
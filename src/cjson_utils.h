@@ -0,0 +1,41 @@
+/*
+    CJson 树的 JSON Pointer（RFC 6901）、JSON Patch（RFC 6902）和 JSON Merge Patch（RFC 7396）
+    键名都区分大小写
+*/
+
+#ifndef CJSON_UTILS_H
+#define CJSON_UTILS_H
+
+#include "cjson.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// 按 JSON Pointer 取节点，如 "/a/0/b"；"" 表示 object 本身。找不到返回 NULL
+extern CJson* cJson_GetPointer(CJson *object, const char *pointer);
+
+// 生成把 from 变成 to 的 JSON Patch（操作组成的数组），from/to 不变。
+// 对象成员用哈希表配对；数组去掉公共的首尾后用 Myers 差分，改动太多时退化为按下标比较。
+// 嵌套超过 CJSON_NESTING_LIMIT 层或内存不足时返回 NULL
+extern CJson* cJson_Diff(CJson *from, CJson *to);
+
+// 在 object 上原地执行 patches，支持 add/remove/replace/move/copy/test。
+// 成功返回 1；失败返回 0，object 保持原样（执行前用 cJson_DuplicateShared 留了快照）
+extern int cJson_ApplyPatch(CJson *object, CJson *patches);
+
+// 把 patch 合并到 target 上，返回合并的结果。两者都是对象时原地修改 target，
+// 否则 target 被释放，返回新的节点。patch 不变。
+// patch 中的对象嵌套超过 CJSON_NESTING_LIMIT 层时 target 被释放，返回 NULL
+extern CJson* cJson_MergePatch(CJson *target, CJson *patch);
+
+// 生成把 from 变成 to 的 Merge Patch；to 中值为 null 的成员无法表示。
+// 嵌套超过 CJSON_NESTING_LIMIT 层或内存不足时返回 NULL
+extern CJson* cJson_GenerateMergePatch(CJson *from, CJson *to);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif